@@ -1,12 +1,26 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h> // offsetof
 #include <string.h>
+#include <ctype.h>
+#include <float.h> // FLT_EVAL_METHOD for the float parser fast path
+#include <math.h>  // model calibration (link with -lm)
+#include <sys/stat.h>
+#include <time.h> // observation timestamps
 // #include <termios.h>  // For terminal settings (to hide password input)
 
 #ifdef _WIN32
 #include <windows.h> // For Wind
 #else
 #include <unistd.h> // For macOS and Unix-based systems
+#include <pthread.h> // background log compaction (build with -pthread)
+#include <fcntl.h>
+#include <sys/mman.h> // mappings of the prediction files and the binary snapshot
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h> // SIMD kernels, picked at run time
+#define HAVE_X86_KERNELS
 #endif
 
 ////////////// CONSTANT ////////////////////
@@ -40,6 +54,7 @@ indicating a threshold beyond which the water level may pose risks, such as floo
 */
 
 #define CONVENTION_FACTOR 0.7 // to convert unit to meter
+
 /*
 If the model outputs a water level in "units" and,
 on average, 1 model unit corresponds to 1.5 meters
@@ -48,13 +63,99 @@ factor would be 1.5 meters per unit. but we are setting to 0.7 for
 our easier calculation.
 */
 
-#define MAX_DATA_ENTRIES 100 // the maximum number of location data i can enter.
+#define RAIN_RECESSION_HOURS 24.0
+/*
+Lead-time forecasts assume no new rain: the share of the current rainfall's
+effect still in the river `h` hours ahead is exp(-h / RAIN_RECESSION_HOURS),
+while temperature and the base level stay as they are.
+*/
+
+#define RAIN_24H_WEIGHT 0.0
+#define RAIN_72H_WEIGHT 0.0
+#define RAIN_7D_WEIGHT 0.0
+/*
+Weights of the rainfall accumulated over the last 24 hours, 72 hours and
+7 days, added to the weighted sum like ALPHA * rainfall. Soil that is already
+wet sends more of the next rain into the river. They are 0 until they are
+calibrated, which leaves the model on instantaneous rainfall only.
+*/
+
+#define ENSEMBLE_RAIN_SPREAD 0.3
+#define ENSEMBLE_TEMPERATURE_SPREAD 1.0
+/*
+Default perturbations of the ensemble forecast: each member scales the
+rainfall by a lognormal factor with this log standard deviation (the mean
+rainfall stays the same) and shifts the temperature by a normal offset with
+this standard deviation in degrees. Admins can pick other distributions.
+*/
+
+#define KALMAN_ERROR_HOURS 12.0
+#define KALMAN_ERROR_SD 1.0
+#define KALMAN_BIAS_SD 0.5
+#define KALMAN_BIAS_DRIFT 0.02
+#define KALMAN_GAUGE_SD 0.05
+/*
+Observed gauge levels correct the model through a filter per station that
+tracks two errors in meters: a transient one that fades with an e-folding
+time of KALMAN_ERROR_HOURS and spreads about KALMAN_ERROR_SD, and a bias
+that starts within KALMAN_BIAS_SD and wanders by KALMAN_BIAS_DRIFT in an
+hour (growing with the square root of the time). Gauges read to within
+KALMAN_GAUGE_SD.
+*/
+
+#define STATION_INITIAL_CAPACITY 4096 // stations the columns hold before their first growth
+#define NAME_POOL_BLOCK 65536         // bytes per block of the location name pool
 
 #define MAX_USERS 100          // value max number of user name for admin and user
 #define MAX_NAME_LENGTH 50     // maximum size for name for admin and user
 #define MAX_PASSWORD_LENGTH 50 // maximum password size;
 #define MAX_LOCATION_LENGTH 50 // maximum location name size;
 
+#define PREDICTION_INDEX_VERSION 2 // bump when the predictions.idx layout changes
+#define MAX_PENDING_CHANGES 64 // changed stations patched into the predictions before falling back to a rebuild
+#define WAL_COMPACT_RECORDS 256 // log records after which data.txt is rewritten in the background
+#define PREDICTION_BLOCK 1024   // fewest rows update_predictions hands to one worker (multiple of 64)
+#define MAX_POOL_THREADS 64     // upper bound on worker threads in the thread pool
+#define LINE_READER_BUFFER (1 << 20) // bytes a LineReader reads from its file at a time
+#define MAX_ROW_LENGTH 256           // longest formatted data.txt or predictions.txt row, newline included
+#define MIN_PARSE_CHUNK (1 << 16)    // fewest bytes of data.txt handed to one parsing thread
+#define SNAPSHOT_VERSION 1           // bump when the snapshot.bin layout changes
+#define SNAPSHOT_ALIGNMENT 64        // every snapshot section starts on a cache line
+#define SNAPSHOT_LOADED_STATIONS 1   // loadBinarySnapshot flags: what was adopted from snapshot.bin
+#define SNAPSHOT_LOADED_ADMINS 2
+#define SNAPSHOT_LOADED_USERS 4
+#define HISTORY_CHUNK_POINTS 512     // observations per compressed history chunk
+#define LEAD_TIMES 5                  // forecast horizons per station, see leadHours
+#define CALIBRATION_MAX_GAP (6 * 3600) // gauge readings pair with observations at most this much older (s)
+#define CALIBRATION_MIN_SAMPLES 10     // paired readings needed to fit a station
+#define ENSEMBLE_MEMBERS 256           // default members per station of an ensemble forecast
+#define ENSEMBLE_MAX_MEMBERS 4096      // upper bound on members per station
+#define ENSEMBLE_SEED 2024             // default seed of the ensemble perturbations
+#define ENSEMBLE_BLOCK 256             // stations per ensemble task on the thread pool
+#define ENSEMBLE_LANES 8               // members whose random numbers are generated together
+#define ROUTING_HOURS 72               // hours routed through the river network, the longest lead time
+#define RIVER_CYCLE_NAMES 10           // stations named in the warning about cycles in network.txt
+#define ROUTING_BLOCK 64               // nodes of a topological wave per routing task on the thread pool
+#define RIVER_DEFAULT_X 0.2            // Muskingum weighting of reaches that don't give one
+#define MAX_HYDROGRAPH_LENGTH 8760     // longest unit hydrograph in hourly ordinates (a year)
+#define CONVOLUTION_FFT_TAPS 384       // shortest kernel convolved through the FFT when AVX2 does the direct path
+#define CONVOLUTION_FFT_TAPS_SCALAR 32 // the same with the scalar direct path
+#define RATING_POINTS 64               // evenly spaced knots of a compiled rating curve
+#define RATING_MAX_UNITS 100.0         // model units a power-law curve covers unless it says otherwise
+#define RATING_TABLE_PAIRS 256         // most (units, stage) pairs on a table line of ratings.txt
+#define RATING_BLOCK 1024              // rows whose curves are looked up per call of the rated kernel
+#define RAIN_WINDOW_HOURS 168         // hourly rainfall kept per station for the rolling sums (7 days)
+#define RAIN_WINDOWS 3                // rolling sums: 24 h, 72 h, 7 d
+#define RECORD_STORE_VERSION 1       // bump when the stations.rec layout changes
+#define RECORD_LIVE 1                // StationRecord flags
+#define RECORD_DELETED 2
+
+// USE_RECORD_STORE keeps stations in data_base/stations.rec, one fixed-width record per station
+// updated in place with pwrite, instead of the write-ahead log (build with -DUSE_RECORD_STORE)
+#if defined(USE_RECORD_STORE) && defined(_WIN32)
+#error "USE_RECORD_STORE needs pwrite, which Windows does not provide"
+#endif
+
 int loggedInUserIndex = -1; // Track the logged-in user's index
 int loggedInAdminIndex = -1; // Track the logged-in user's index
 
@@ -96,6 +197,351 @@ typedef struct
     char location[50];
 } EnvironmentalData;
 
+// station table stored column by column, so numeric loops only pull the columns they read
+typedef struct
+{
+    float *rainfall;
+    float *temperature;
+    float *waterLevel;          // filled by the prediction code
+    unsigned long long *alerts; // one alert bit per station, filled with waterLevel
+    char **location;            // names live in the name pool
+    int *curve;                 // rating curve of each station, -1 for CONVENTION_FACTOR
+    int *parameters;            // parameter row of each station, -1 for the defaults
+    int capacity;
+#ifdef USE_RECORD_STORE
+    int *recordId; // record of each station in stations.rec
+#endif
+} StationTable;
+
+// one observation of a station's history
+typedef struct
+{
+    long long time; // seconds since the epoch
+    float rainfall;
+    float temperature;
+} Observation;
+
+// Gorilla coder state after a point: previous time/step and, per value column, the previous bits and XOR window
+typedef struct
+{
+    long long time;
+    long long delta;
+    unsigned int value[2]; // rainfall, temperature as raw float bits
+    int leading[2];
+    int length[2]; // 0 until the first non-zero XOR
+} GorillaState;
+
+// up to HISTORY_CHUNK_POINTS compressed observations
+typedef struct
+{
+    long long firstTime;
+    long long lastTime;
+    int points;
+    int persistedPoints; // points covered by the newest block of this chunk in history.bin
+    GorillaState state;  // lets appends continue the stream
+    unsigned char *bits;
+    size_t bitLength;
+    size_t byteCapacity;
+} HistoryChunk;
+
+// model coefficients, in the column order of params.txt
+enum
+{
+    PARAM_ALPHA,
+    PARAM_BETA,
+    PARAM_GAMMA,
+    PARAM_FACTOR,
+    PARAM_THRESHOLD,
+    PARAM_RAIN_24H,
+    PARAM_RAIN_72H,
+    PARAM_RAIN_7D,
+    MODEL_PARAMETERS
+};
+
+// coefficients of the calibrated stations, one column per coefficient
+typedef struct
+{
+    double *column[MODEL_PARAMETERS];
+    char **location; // names live in the name pool
+    int count;
+    int capacity;
+} ParameterTable;
+
+// distributions the ensemble draws its input perturbations from
+enum
+{
+    ENSEMBLE_FIXED,     // unperturbed
+    ENSEMBLE_NORMAL,    // value + spread * N(0, 1)
+    ENSEMBLE_LOGNORMAL, // value * exp(spread * N(0, 1) - spread^2 / 2), same mean
+    ENSEMBLE_UNIFORM,   // value + spread * U(-1, 1)
+    ENSEMBLE_DISTRIBUTIONS
+};
+
+// how an ensemble forecast perturbs the station inputs, kept in ensemble.txt
+typedef struct
+{
+    int members;
+    unsigned long long seed;
+    int rainDistribution;
+    double rainSpread;
+    int temperatureDistribution;
+    double temperatureSpread;
+} EnsembleSettings;
+
+// stage-discharge curves of the stations that have one, compiled to RATING_POINTS evenly spaced knots
+typedef struct
+{
+    float *knots;    // RATING_POINTS stages per curve, in meters
+    float *low;      // model units of each curve's first knot
+    float *scale;    // knots per model unit
+    char **location; // names live in the name pool
+    int count;
+    int capacity;
+    int *index; // curve + 1, 0 = empty bucket
+    unsigned int indexCapacity;
+} RatingTable;
+
+// gauge filter of the stations with observed levels: state and covariance column-wise, rows found by name
+typedef struct
+{
+    double *error; // transient model error in meters, as of the row's last reading
+    double *bias;  // lasting model error in meters
+    double *p00;   // covariance of (error, bias)
+    double *p01;
+    double *p11;
+    long long *time; // last reading assimilated, 0 before the first
+    char **location; // names live in the name pool
+    int count;
+    int capacity;
+    int *index; // row + 1, 0 = empty bucket
+    unsigned int indexCapacity;
+    long long offset; // bytes of gauges.txt assimilated, up to the end of a line
+} GaugeFilter;
+
+// lanes of one assimilation round: a station's filter state and its next gauge reading per lane
+typedef struct
+{
+    double *error;
+    double *bias;
+    double *p00;
+    double *p01;
+    double *p11;
+    const double *observed;  // gauge level
+    const double *predicted; // model level at the reading
+    const double *decay;     // share of the transient error left since the previous reading
+    const double *hours;     // hours since the previous reading
+} KalmanBatch;
+
+// one reach of the river network as read from network.txt
+typedef struct
+{
+    int upstream; // river nodes
+    int downstream;
+    float c0; // Muskingum coefficients for a 1 hour step
+    float c1;
+    float c2;
+    float share; // of the upstream flow that reaches the downstream station
+} RiverReach;
+
+// stations on connected rivers, with the upstream reaches of each node in CSR form
+typedef struct
+{
+    char **location; // node names, in the name pool
+    int nodeCount;
+    int nodeCapacity;
+    int *index; // node + 1, 0 = empty bucket
+    unsigned int indexCapacity;
+    RiverReach *reaches; // as read
+    int reachCount;
+    int reachCapacity;
+    int *inStart;   // the reaches into node n are inReach[inStart[n], inStart[n + 1])
+    int *inReach;
+    int *order;     // nodes wave by wave; a wave only has upstream nodes in earlier waves
+    int *waveStart; // waveCount + 1 offsets into order
+    int waveCount;
+    float *outflow; // (ROUTING_HOURS + 1) hourly values per node
+    float *routed;  // LEAD_TIMES per node: flow arriving from upstream at each lead time, in meters
+} RiverNetwork;
+
+// what the members of one station's ensemble say
+typedef struct
+{
+    float p10; // water level percentiles in meters
+    float p50;
+    float p90;
+    float exceedance; // share of members above the station's danger level
+} EnsembleResult;
+
+// hourly rainfall ring of a station with its rolling sums, in hundredths of a mm
+typedef struct
+{
+    long long hour; // newest hour in the ring (time / 3600)
+    long long sum[RAIN_WINDOWS];
+    int bucket[RAIN_WINDOW_HOURS]; // hour h at h % RAIN_WINDOW_HOURS
+} RainfallWindow;
+
+// the observation history of one location, chunks in time order
+typedef struct
+{
+    char location[MAX_LOCATION_LENGTH];
+    RainfallWindow *rainfall; // NULL until the first observation
+    float *hydrograph; // unit hydrograph, hourly ordinates (NULL = the rainfall acts at once)
+    int hydrographLength;
+    HistoryChunk *chunks;
+    int chunkCount;
+    int chunkCapacity;
+} HistorySeries;
+
+// header of one chunk block in history.bin, followed by the chunk's bit stream
+typedef struct
+{
+    char magic[4]; // "FHCK"
+    unsigned int points;
+    long long firstTime;
+    long long lastTime;
+    GorillaState state;
+    unsigned long long bitLength;
+    unsigned long long checksum; // of the bit stream
+    char location[MAX_LOCATION_LENGTH];
+    unsigned long long headerChecksum; // of everything above
+} HistoryBlock;
+
+// header at the start of stations.rec
+typedef struct
+{
+    char magic[4]; // "FREC"
+    unsigned int version;
+    unsigned int recordSize;
+    unsigned int dirty;   // set while data.txt is behind the records
+    long long exportSize; // data.txt as last exported from the store (fileStamp)
+    long long exportTime;
+    char reserved[32];
+} RecordStoreHeader;
+
+// one fixed-width station record of stations.rec, at sizeof(RecordStoreHeader) + id * sizeof(StationRecord)
+typedef struct
+{
+    unsigned int flags; // RECORD_LIVE, or RECORD_DELETED for a tombstone whose ID is on the free list
+    float rainfall;
+    float temperature;
+    char location[MAX_LOCATION_LENGTH];
+    char reserved[64 - 12 - MAX_LOCATION_LENGTH]; // 64 bytes per record
+} StationRecord;
+
+// header of the predictions sidecar index, followed by `capacity` PredictionIndexEntry buckets
+typedef struct
+{
+    char magic[4]; // "FPIX"
+    unsigned int version;
+    unsigned int capacity; // number of buckets, a power of two
+    unsigned int entries;
+    unsigned int tombstones;   // buckets of deleted rows, they still lengthen the probe chains
+    long long predictionsSize; // size of the predictions file the index was built for
+    long long deadBytes;       // bytes of rows blanked by patches since the file was written
+} PredictionIndexHeader;
+
+// one bucket of the predictions sidecar index
+typedef struct
+{
+    unsigned int hash; // hashLocation() of the row's location
+    unsigned int reserved;
+    long long offset; // byte offset of the row + 1, 0 means empty bucket, -1 means deleted row
+} PredictionIndexEntry;
+
+// one whitespace-separated field of a line, pointing into the reader's buffer (not NUL-terminated)
+typedef struct
+{
+    const char *start;
+    size_t length;
+} TextField;
+
+// reads a text file through one large buffer and hands out lines without copying them
+typedef struct
+{
+    FILE *file;
+    char *data;
+    size_t size;     // bytes held in data
+    size_t position; // start of the next line in data
+    size_t capacity;
+    int eof;
+    int mapped; // data is a read-only mapping of the whole file
+} LineReader;
+
+// a whole file mapped read-only (data is NULL for an empty file)
+typedef struct
+{
+    const char *data;
+    size_t size;
+} MappedFile;
+
+// data.txt rows parsed into columns, in file order
+typedef struct
+{
+    char (*names)[MAX_LOCATION_LENGTH];
+    float *rainfall;
+    float *temperature;
+    int rows;
+} StationColumns;
+
+// sections of the binary snapshot, each stored as a plain array that is used in place
+enum
+{
+    SNAPSHOT_RAINFALL,     // float[capacity]
+    SNAPSHOT_TEMPERATURE,  // float[capacity]
+    SNAPSHOT_WATER_LEVEL,  // float[capacity], the predictions
+    SNAPSHOT_ALERTS,       // unsigned long long[capacity / 64], the alert bits
+    SNAPSHOT_NAME_OFFSETS, // unsigned int[count], offset of each name in SNAPSHOT_NAMES
+    SNAPSHOT_NAMES,        // NUL-terminated location names
+    SNAPSHOT_INDEX,        // int[index capacity], the location index buckets
+    SNAPSHOT_ADMINS,       // Admin[adminCount]
+    SNAPSHOT_USERS,        // User[userCount]
+    SNAPSHOT_SECTIONS
+};
+
+// one section of the binary snapshot
+typedef struct
+{
+    unsigned long long offset; // from the start of the file, a multiple of SNAPSHOT_ALIGNMENT
+    unsigned long long length; // bytes
+    unsigned long long checksum;
+    long long sourceSize; // size and modification time of the text file the section mirrors
+    long long sourceTime;
+    unsigned int items;
+    unsigned int reserved;
+} SnapshotSection;
+
+// header at the start of snapshot.bin
+typedef struct
+{
+    char magic[4]; // "FSNP"
+    unsigned int version;
+    unsigned int byteOrder; // 0x01020304 as written, rejects files from a machine of the other endianness
+    unsigned int sectionCount;
+    long long walSequence; // last write-ahead log record the station sections include
+    SnapshotSection sections[SNAPSHOT_SECTIONS];
+    unsigned long long headerChecksum; // over everything above
+} SnapshotHeader;
+
+// a data file split into line-aligned byte ranges parsed by the thread pool
+typedef struct
+{
+    const char *data;
+    size_t size;
+    int chunks;
+    size_t *start; // chunks + 1 boundaries, each at the start of a line
+    int *first;    // first row of each chunk in the columns
+    int *parsed;   // rows each chunk kept (malformed lines are dropped)
+    StationColumns *columns;
+} StationParseJob;
+
+// growable text buffer rows are formatted into before one large write
+typedef struct
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+} TextBuffer;
+
 //////////////////////////// END /////////////////////////////
 
 ////////////////////// INITIALIZING ///////////////////////////
@@ -108,12 +554,121 @@ int adminCount = 0; // to track number of admin created
 User users[MAX_USERS];
 int userCount = 0; // to track number of user created
 
-// array for envermental data
-EnvironmentalData data[MAX_DATA_ENTRIES];
+// growable table for envermental data; a station keeps its slot as the columns grow
+StationTable stations = {0}; // every column NULL, capacity 0
 int count = 0; // to track number of data entered
 
+// forecast water levels at every lead time, LEAD_TIMES per station slot (derived like stations.waterLevel)
+const int leadHours[LEAD_TIMES] = {6, 12, 24, 48, 72};
+float *leadLevels = NULL;
+int leadCapacity = 0;
+
+// location names are copied into large pool blocks instead of one allocation per station
+char *namePoolBlock = NULL;
+size_t namePoolUsed = NAME_POOL_BLOCK;
+
+// hash index from case-folded location name to station slot (slot + 1, 0 means empty bucket)
+int *locationIndex = NULL;
+unsigned int locationIndexCapacity = 0; // power of two, kept at least twice the station count
+
+// stations changed since the predictions were last written, reported by the storage layer
+char pendingChanges[MAX_PENDING_CHANGES][MAX_LOCATION_LENGTH];
+int pendingChangeCount = 0;
+int pendingChangesOverflowed = 0;
+
 const char *input_file = "data_base/data.txt";             // File for environmental data
 const char *prediction_file = "data_base/predictions.txt"; // File for predictions
+const char *log_file = "data_base/data.wal";               // Write-ahead log of station mutations
+const char *snapshot_file = "data_base/snapshot.bin";      // Binary snapshot of the tables for fast startup
+
+// calibrated model coefficients, found by name through their own index
+const char *parameter_file = "data_base/params.txt";
+const char *gauge_file = "data_base/gauges.txt"; // observed water levels, for calibration and the gauge filter
+ParameterTable stationParameters = {{NULL}, NULL, 0, 0};
+int *parameterIndex = NULL; // row + 1, 0 = empty bucket
+unsigned int parameterIndexCapacity = 0;
+
+// rating curves replacing CONVENTION_FACTOR at the stations that have one
+const char *rating_file = "data_base/ratings.txt";
+RatingTable ratingCurves = {NULL, NULL, NULL, NULL, 0, 0, NULL, 0};
+
+// gauge filter correcting the displayed levels with the readings in gauges.txt
+const char *filter_file = "data_base/gauge_filter.txt"; // filter state, so only newer readings are read again
+GaugeFilter gaugeFilter = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, 0, NULL, 0, 0};
+
+// river network for routing upstream flows into downstream forecasts
+const char *network_file = "data_base/network.txt";
+RiverNetwork riverNetwork = {NULL, 0, 0, NULL, 0, NULL, 0, 0, NULL, NULL, NULL, NULL, 0, NULL, NULL};
+int riverRoutingStale = 1; // station inputs changed since the network was last routed
+
+// ensemble forecast settings
+const char *ensemble_file = "data_base/ensemble.txt";
+EnsembleSettings ensembleSettings = {ENSEMBLE_MEMBERS, ENSEMBLE_SEED, ENSEMBLE_LOGNORMAL, ENSEMBLE_RAIN_SPREAD,
+                                     ENSEMBLE_NORMAL, ENSEMBLE_TEMPERATURE_SPREAD};
+
+// observation history: series found through their own open-addressing index
+const char *history_file = "data_base/history.bin";
+const char *history_journal = "data_base/history.wal";
+const char *hydrograph_file = "data_base/hydrographs.txt"; // unit hydrographs of the series
+int hydrographCount = 0;                                   // series with one
+HistorySeries *historySeries = NULL;
+int historySeriesCount = 0;
+int historySeriesCapacity = 0;
+int *historyIndex = NULL; // series + 1, 0 = empty bucket
+unsigned int historyIndexCapacity = 0;
+FILE *historyJournal = NULL;
+int historyLoaded = 0;                // chunks are only written out once history.bin has been read
+long long historySupersededBytes = 0; // bytes of history.bin rewritten by later blocks
+
+// record store state (USE_RECORD_STORE builds)
+const char *record_file = "data_base/stations.rec";
+int recordFd = -1;
+int recordCount = 0;     // records in the file, tombstones included
+int *freeRecords = NULL; // IDs of tombstoned records, reused by inserts
+int freeRecordCount = 0;
+int freeRecordCapacity = 0;
+int recordStoreDirty = 0; // data.txt export is behind the record store
+
+// binary snapshot state: adopted columns point into the snapshot mapping until they first grow
+int stationColumnsMapped = 0;
+int locationIndexMapped = 0;
+long long snapshotSequence = 0; // log records up to this sequence are already in the loaded table
+
+// write-ahead log state
+FILE *walFile = NULL;
+long long walSequence = 0; // sequence number of the last logged mutation
+int walRecords = 0;        // records logged since the last compaction
+
+// background compaction state
+char *compactionSnapshot = NULL;
+size_t compactionLength = 0;
+int compactionRunning = 0;
+#ifndef _WIN32
+pthread_t compactionThread;
+#endif
+
+// thread pool state (tasks are handed out by index under poolLock)
+int poolThreads = 0;  // threads running pool tasks, caller included; 0 = one per online core
+int poolWorkerCount = 0;
+#ifndef _WIN32
+pthread_t poolWorkers[MAX_POOL_THREADS];
+pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t poolWake = PTHREAD_COND_INITIALIZER;
+pthread_cond_t poolDone = PTHREAD_COND_INITIALIZER;
+void (*poolTask)(int task, void *arg) = NULL;
+void *poolArg = NULL;
+int poolNextTask = 0, poolTaskCount = 0, poolFinished = 0, poolStopping = 0;
+unsigned int poolGeneration = 0;
+#endif
+
+// one-time initialisation that pool tasks may reach together (see runOnce)
+#ifdef _WIN32
+typedef int OnceFlag; // the pool is the calling thread alone there
+#define ONCE_INIT 0
+#else
+typedef pthread_once_t OnceFlag;
+#define ONCE_INIT PTHREAD_ONCE_INIT
+#endif
 
 ////////////////// END ////////////////////////
 
@@ -146,7 +701,7 @@ int compareLocations(const char *location1, const char *location2)
 }
 
 
-void loadingDotsAnimation(int duration, char str[10])
+void loadingDotsAnimation(int duration, const char *str)
 {
     printf("\033[1;32m");  // Set text color to green (optional for styling)
     printf("%s", str);
@@ -173,554 +728,7272 @@ void loadingDotsAnimation(int duration, char str[10])
 }
 ///////////////// END ///////////////////////////
 
-///////////////////////// 232-35-048/////////////////////////////////////////////////////////////////////////////////////////////
+///////////////// GROWABLE STATION STORE ///////////////////////////
 
-//////////// code for load and saving file/////////////////
+// Function to grow one column to a new capacity
+int growColumn(void **column, size_t elementSize, int capacity)
+{
+    void *grown = realloc(*column, (size_t)capacity * elementSize);
+    if (grown == NULL)
+    {
+        return 0;
+    }
+    *column = grown;
+    return 1;
+}
 
-// Function to save environmental data to a file
-void saveDataToFile(const EnvironmentalData *data, int count)
+// Function to move a column that cannot be realloc'ed (it lives in a mapping) to the heap
+int copyColumnToHeap(void **column, size_t elementSize, int used)
 {
-    FILE *file = fopen("data_base/data.txt", "a"); // Open file in append mode
-    if (file == NULL)
+    void *copy = malloc(used > 0 ? (size_t)used * elementSize : 1);
+    if (copy == NULL)
     {
-        printf("Error opening file for writing.\n");
-        return;
+        return 0;
     }
-    // Write each entry to the file
-    for (int i = 0; i < count; i++)
+    if (used > 0)
     {
-        fprintf(file, "%s %.2f %.2f\n", data[i].location, data[i].rainfall, data[i].temperature);
+        memcpy(copy, *column, (size_t)used * elementSize);
     }
-    fclose(file);
-    printf("\033[1;32m"); // Green for success
-    printf("Data saved successfully to data.txt.\n");
-    printf("\033[0m"); // Reset color
+    *column = copy;
+    return 1;
 }
 
-// Function to load environmental data from a file
-int loadDataFromFile(EnvironmentalData *data)
+// Function to make sure slot `count` exists, doubling the columns when the table is full
+int reserveStationSlot()
 {
-    FILE *file = fopen("data_base/data.txt", "r"); // Changed to consistent file name
-    
-    if (file == NULL)  // If the file doesn't exist
+    if (count < stations.capacity)
     {
-        //printf("File doesn't exist. Creating a new file.\n");
-        // Open the file in append mode to create it
-        file = fopen("data_base/data.txt", "a");
-        if (file == NULL)  // Check if the file was successfully created
-        {
-            printf("Error creating the file.\n");
-            return 0; // Indicate failure to create the file
-        }
-        else
+        return 1;
+    }
+
+    if (stationColumnsMapped)
+    {
+        // columns adopted from the binary snapshot live inside its mapping and cannot be realloc'ed
+        if (!copyColumnToHeap((void **)&stations.rainfall, sizeof(float), stations.capacity) ||
+            !copyColumnToHeap((void **)&stations.temperature, sizeof(float), stations.capacity) ||
+            !copyColumnToHeap((void **)&stations.waterLevel, sizeof(float), stations.capacity) ||
+            !copyColumnToHeap((void **)&stations.alerts, sizeof(unsigned long long), stations.capacity / 64))
         {
-            fclose(file);  // Close the newly created file
-            return 0;      // Return 0 because no data to load yet
+            return 0;
         }
+        stationColumnsMapped = 0;
     }
 
-    int count = 0;
-    // Read data until end of file or maximum entries
-    while (fscanf(file, "%s %f %f", data[count].location, &data[count].rainfall, &data[count].temperature) == 3)
+    int capacity = stations.capacity ? stations.capacity * 2 : STATION_INITIAL_CAPACITY;
+    if (!growColumn((void **)&stations.rainfall, sizeof(float), capacity) ||
+        !growColumn((void **)&stations.temperature, sizeof(float), capacity) ||
+        !growColumn((void **)&stations.waterLevel, sizeof(float), capacity) ||
+        !growColumn((void **)&stations.alerts, sizeof(unsigned long long), capacity / 64) ||
+        !growColumn((void **)&stations.location, sizeof(char *), capacity) ||
+        !growColumn((void **)&stations.curve, sizeof(int), capacity) ||
+        !growColumn((void **)&stations.parameters, sizeof(int), capacity))
+    {
+        return 0; // columns that did grow are just larger than needed
+    }
+#ifdef USE_RECORD_STORE
+    if (!growColumn((void **)&stations.recordId, sizeof(int), capacity))
     {
-        count++;
-        if (count >= MAX_DATA_ENTRIES)
-            break; // Prevent overflow
+        return 0;
     }
+#endif
+    stations.capacity = capacity;
+    return 1;
+}
 
-    fclose(file);
-    // printf("\033[1;32m"); // Green for success
-    // printf("Data loaded successfully. %d entries read.\n", count);
-    // printf("\033[0m"); // Reset color
+// Function to copy a location name into the name pool
+char *poolLocation(const char *location)
+{
+    size_t length = strlen(location) + 1;
 
-    return count; // Return the number of entries loaded
-}
-///////////////////// END////// END//////////////////////////////
+    if (namePoolUsed + length > NAME_POOL_BLOCK)
+    {
+        char *block = malloc(NAME_POOL_BLOCK); // blocks are never freed, names only move on restart
+        if (block == NULL)
+        {
+            return NULL;
+        }
+        namePoolBlock = block;
+        namePoolUsed = 0;
+    }
 
-//////// CODE FOR TAKE INPUT////////////
+    char *name = namePoolBlock + namePoolUsed;
+    memcpy(name, location, length);
+    namePoolUsed += length;
+    return name;
+}
 
-// Function to input data and append to the file
-void inputData(EnvironmentalData *data, int *count)
+// Function to set or clear one alert bit
+void setAlertBit(unsigned long long *alerts, int i, int on)
 {
-    char newLocation[50];
-    int locationExists = 0;
+    unsigned long long bit = 1ULL << (i & 63);
+    alerts[i >> 6] = on ? (alerts[i >> 6] | bit) : (alerts[i >> 6] & ~bit);
+}
 
-    // Load existing data from file
-    EnvironmentalData existingData[MAX_DATA_ENTRIES];
-    int existingCount = loadDataFromFile(existingData);
+// Function to test one alert bit
+int alertBit(const unsigned long long *alerts, int i)
+{
+    return (int)((alerts[i >> 6] >> (i & 63)) & 1);
+}
 
-    // Copy existing data into the current array (if needed for other operations)
-    for (int i = 0; i < existingCount; i++)
+// Function to append a station to the table without indexing it, returns its slot or -1 when out of memory
+int appendStation(const char *location, float rainfall, float temperature)
+{
+    char *name;
+    if (!reserveStationSlot() || (name = poolLocation(location)) == NULL)
     {
-        data[i] = existingData[i];
+        return -1;
     }
-    *count = existingCount;
 
-    // Get location input from user
-    printf("\033[1;34m"); // Blue for input prompts
-    printf("Enter location: ");
-    printf("\033[0m"); // Reset color
+    stations.location[count] = name;
+    stations.rainfall[count] = rainfall;
+    stations.temperature[count] = temperature;
+    stations.waterLevel[count] = 0;
+    stations.curve[count] = -1; // tables are loaded before the models, which map their own slots
+    stations.parameters[count] = -1;
+    setAlertBit(stations.alerts, count, 0);
+    return count++;
+}
 
-    printf("\033[1;33m");
-    scanf("%s", newLocation);
-    printf("\033[0m");
+///////////////// END ///////////////////////////
 
-    // Check if location already exists in the loaded data (case-insensitive)
-    for (int i = 0; i < existingCount; i++)
+///////////////// LOCATION HASH INDEX ///////////////////////////
+
+// Function to hash a location name the same way compareLocations compares it (FNV-1a over lower case)
+unsigned int hashLocation(const char *location)
+{
+    unsigned int hash = 2166136261u;
+    for (; *location != '\0'; location++)
     {
-        if (compareLocations(existingData[i].location, newLocation) == 0)
-        {
-            printf("\033[1;31m"); // Red for error
-            printf("Location '%s' already exists.\n", newLocation);
-            printf("\033[0m"); // Reset color
-            locationExists = 1;
-            break;
-        }
+        hash ^= (unsigned char)tolower((unsigned char)*location);
+        hash *= 16777619u;
     }
+    return hash;
+}
 
-    // If location doesn't exist, proceed with data input
-    if (!locationExists)
+// Function to find the slot of a location, -1 if it is not in the table
+int findLocation(const char *location)
+{
+    if (locationIndexCapacity == 0)
     {
-        strcpy(data[*count].location, newLocation);
-        printf("\033[1;34m"); // Blue for input prompts
-        printf("Enter rainfall (in mm): ");
-        printf("\033[0m"); // Reset color
-
-        printf("\033[1;33m");
-        scanf("%f", &data[*count].rainfall);
-        printf("\033[0m");
-
-        printf("\033[1;34m"); // Blue for input prompts
-        printf("Enter temperature (in degrees celsius): ");
-        printf("\033[0m"); // Reset color
-
-        printf("\033[1;33m");
-        scanf("%f", &data[*count].temperature);
-        printf("\033[0m");
+        return -1; // nothing loaded yet
+    }
 
-        clearScreen();
-        printf("\033[1;32m"); // Green for success message
-        loadingDotsAnimation(2,"Saving");
-        //printf("\nPlease wait...\n");
-        printf("\033[0m"); // Reset color
-        //delay(2);
-        printf("\033[1;32m"); // Green for success message
-        printf("\n\nData Saved Successfully for %s.\n", data[*count].location);
-        printf("\033[0m"); // Reset color
-        delay(1);
+    unsigned int bucket = hashLocation(location) & (locationIndexCapacity - 1);
 
-        // Append the new data to the file
-        FILE *file = fopen("data_base/data.txt", "a");
-        if (file != NULL)
-        {
-            fprintf(file, "%s %.2f %.2f\n", data[*count].location, data[*count].rainfall, data[*count].temperature);
-            fclose(file);
-        }
-        else
+    while (locationIndex[bucket] != 0)
+    {
+        int slot = locationIndex[bucket] - 1;
+        if (compareLocations(stations.location[slot], location) == 0)
         {
-            printf("\033[1;31m"); // Red for error
-            printf("Error saving data.\n");
-            printf("\033[0m"); // Reset color
+            return slot;
         }
-
-        (*count)++; // Increment count of entries
+        bucket = (bucket + 1) & (locationIndexCapacity - 1); // linear probing
     }
+    return -1;
 }
 
-
-///delete data based on location
-void deleteData(EnvironmentalData *data, int *count)
+// Function to add a station slot to the index
+void indexLocation(int slot)
 {
-    char locationToDelete[50];
-    int locationFound = 0;
-
-    // Load existing data from file
-    EnvironmentalData existingData[MAX_DATA_ENTRIES];
-    int existingCount = loadDataFromFile(existingData);
-
-    // Get location to delete from user
-    printf("\033[1;34m"); // Blue for input prompts
-    printf("Enter the location to delete: ");
-    printf("\033[0m"); // Reset color
-
-    printf("\033[1;33m");
-    scanf("%s", locationToDelete);
-    printf("\033[0m");
+    unsigned int bucket = hashLocation(stations.location[slot]) & (locationIndexCapacity - 1);
 
-    // Search for the location in the loaded data
-    for (int i = 0; i < existingCount; i++)
+    while (locationIndex[bucket] != 0)
     {
-        if (compareLocations(existingData[i].location, locationToDelete) == 0) // Location found
-        {   
+        bucket = (bucket + 1) & (locationIndexCapacity - 1);
+    }
+    locationIndex[bucket] = slot + 1;
+}
 
-            clearScreen();
-            loadingDotsAnimation(2,"Deleting");
-            clearScreen();
+// Function to find the bucket holding a slot (the slot must be indexed)
+unsigned int findIndexBucket(int slot)
+{
+    unsigned int bucket = hashLocation(stations.location[slot]) & (locationIndexCapacity - 1);
 
-            locationFound = 1;
-            printf("\033[1;32m"); // Green for success
-            printf("\nData successfully deleted for location: %s\n", locationToDelete);
-            printf("\033[0m"); // Reset color
+    while (locationIndex[bucket] != slot + 1)
+    {
+        bucket = (bucket + 1) & (locationIndexCapacity - 1);
+    }
+    return bucket;
+}
 
-            // Shift the remaining entries to "delete" the location
-            for (int j = i; j < existingCount - 1; j++)
-            {
-                existingData[j] = existingData[j + 1];
-            }
+// Function to remove a station slot from the index, shifting later entries of the probe chain back
+void unindexLocation(int slot)
+{
+    unsigned int hole = findIndexBucket(slot);
+    unsigned int bucket = hole;
 
-            // Reduce the count of entries
-            existingCount--;
+    while (1)
+    {
+        bucket = (bucket + 1) & (locationIndexCapacity - 1);
+        if (locationIndex[bucket] == 0)
+        {
             break;
         }
+
+        unsigned int home = hashLocation(stations.location[locationIndex[bucket] - 1]) & (locationIndexCapacity - 1);
+        // move the entry into the hole unless its home bucket lies cyclically in (hole, bucket]
+        int stays = (hole <= bucket) ? (hole < home && home <= bucket) : (hole < home || home <= bucket);
+        if (!stays)
+        {
+            locationIndex[hole] = locationIndex[bucket];
+            hole = bucket;
+        }
     }
+    locationIndex[hole] = 0;
+}
+
+// Function to point the index at a station that moved from one slot to another
+void moveIndexedLocation(int from, int to)
+{
+    locationIndex[findIndexBucket(from)] = to + 1;
+}
 
-    if (!locationFound)
+// Function to rebuild the index with room for `stations` stations (at most half full)
+int resizeLocationIndex(int stations)
+{
+    unsigned int capacity = 16;
+    while (capacity < 2u * (unsigned int)stations)
     {
-        printf("\033[1;31m"); // Red for error
-        printf("Location '%s' not found.\n", locationToDelete);
-        printf("\033[0m"); // Reset color
-        return;
+        capacity *= 2;
     }
 
-    // Save the updated data back to the file (overwrite the file)
-    FILE *file = fopen("data_base/data.txt", "w"); // Open file in write mode to overwrite
-    if (file != NULL)
+    int *index = calloc(capacity, sizeof(int));
+    if (index == NULL)
     {
-        for (int i = 0; i < existingCount; i++)
-        {
-            fprintf(file, "%s %.2f %.2f\n", existingData[i].location, existingData[i].rainfall, existingData[i].temperature);
-        }
-        fclose(file);
-        //printf("\033[1;32m"); // Green for success
-        //printf("Data successfully deleted for location: %s\n", locationToDelete);
-        //printf("\033[0m"); // Reset color
+        return 0;
     }
-    else
+    if (!locationIndexMapped)
     {
-        printf("\033[1;31m"); // Red for error
-        printf("Error saving data.\n");
-        printf("\033[0m"); // Reset color
+        free(locationIndex);
     }
+    locationIndexMapped = 0;
+    locationIndex = index;
+    locationIndexCapacity = capacity;
 
-    *count = existingCount; // Update the count of entries in the array
+    for (int i = 0; i < count; i++)
+    {
+        indexLocation(i);
+    }
+    return 1;
 }
 
+// Function to rebuild the index after the table is loaded
+void rebuildLocationIndex()
+{
+    resizeLocationIndex(count);
+}
 
+///////////////// END ///////////////////////////
 
-///////////////// END //////////////
+///////////////// STATION TABLE OPERATIONS ///////////////////////////
 
-///////////// FOR UPDATE ENV DATA /////////////
-void updateData(EnvironmentalData *data, int count)
+// Function to find the parameter row of a location, -1 when it uses the defaults
+int findStationParameters(const char *location)
 {
-    int foundIndex = -1;
+    if (stationParameters.count == 0)
+    {
+        return -1; // every station on the defaults
+    }
+    unsigned int bucket = hashLocation(location) & (parameterIndexCapacity - 1);
+    while (parameterIndex[bucket] != 0)
+    {
+        int row = parameterIndex[bucket] - 1;
+        if (compareLocations(stationParameters.location[row], location) == 0)
+        {
+            return row;
+        }
+        bucket = (bucket + 1) & (parameterIndexCapacity - 1);
+    }
+    return -1;
+}
+
+// Function to find the rating curve of a location, -1 when it uses CONVENTION_FACTOR
+int findRatingCurve(const char *location)
+{
+    if (ratingCurves.count == 0)
+    {
+        return -1;
+    }
+    unsigned int bucket = hashLocation(location) & (ratingCurves.indexCapacity - 1);
+    while (ratingCurves.index[bucket] != 0)
+    {
+        int curve = ratingCurves.index[bucket] - 1;
+        if (compareLocations(ratingCurves.location[curve], location) == 0)
+        {
+            return curve;
+        }
+        bucket = (bucket + 1) & (ratingCurves.indexCapacity - 1);
+    }
+    return -1;
+}
+
+// Function to point a slot at its station's parameter row and rating curve
+void mapStationSlot(int slot)
+{
+    stations.parameters[slot] = findStationParameters(stations.location[slot]);
+    stations.curve[slot] = findRatingCurve(stations.location[slot]);
+}
+
+// Function to add a station to the table and the index, returns its slot or -1 when out of memory
+int insertStation(const char *location, float rainfall, float temperature)
+{
+    if (2u * (unsigned int)(count + 1) > locationIndexCapacity && !resizeLocationIndex(2 * (count + 1)))
+    {
+        return -1;
+    }
+
+    int slot = appendStation(location, rainfall, temperature);
+    if (slot != -1)
+    {
+        indexLocation(slot);
+        mapStationSlot(slot);
+    }
+    return slot;
+}
+
+// Function to remove a station by moving the last entry into its slot
+void removeStation(int slot)
+{
+    unindexLocation(slot);
+    if (slot != count - 1)
+    {
+        int last = count - 1;
+        moveIndexedLocation(last, slot);
+        stations.location[slot] = stations.location[last];
+        stations.rainfall[slot] = stations.rainfall[last];
+        stations.temperature[slot] = stations.temperature[last];
+        stations.waterLevel[slot] = stations.waterLevel[last];
+        stations.curve[slot] = stations.curve[last];
+        stations.parameters[slot] = stations.parameters[last];
+        setAlertBit(stations.alerts, slot, alertBit(stations.alerts, last));
+        if (last < leadCapacity)
+        {
+            memcpy(&leadLevels[slot * LEAD_TIMES], &leadLevels[last * LEAD_TIMES], LEAD_TIMES * sizeof(float));
+        }
+#ifdef USE_RECORD_STORE
+        stations.recordId[slot] = stations.recordId[last];
+#endif
+    }
+    count--;
+    riverRoutingStale = 1; // the station no longer feeds the river network
+}
+
+///////////////// END ///////////////////////////
+
+///////////////////////// FAST TEXT WRITER ///////////////////////////
+
+// Function to write value exactly like printf("%.2f"), returns the number of characters written (no NUL).
+// value * 100 is exact in a double (24-bit mantissa times 100 fits in 53 bits), so rounding it to an
+// integer with ties to even gives the same digits printf produces. Huge values, inf and nan use printf.
+int formatFixed2(char *out, float value)
+{
+    double scaled = (double)value * 100.0;
+    if (!(scaled > -1e15 && scaled < 1e15))
+    {
+        return sprintf(out, "%.2f", value);
+    }
+
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int negative = bits >> 31; // printf keeps the sign of -0.0 and of values that round to zero
+
+    double magnitude = negative ? -scaled : scaled;
+    unsigned long long cents = (unsigned long long)magnitude;
+    double rest = magnitude - (double)cents; // exact, magnitude is below 2^53
+    if (rest > 0.5 || (rest == 0.5 && (cents & 1)))
+    {
+        cents++;
+    }
+
+    char digits[24];
+    int n = 0;
+    do
+    {
+        digits[n++] = (char)('0' + cents % 10);
+        cents /= 10;
+    } while (cents > 0 || n < 3);
+
+    int length = 0;
+    if (negative)
+    {
+        out[length++] = '-';
+    }
+    while (n > 2)
+    {
+        out[length++] = digits[--n];
+    }
+    out[length++] = '.';
+    out[length++] = digits[1];
+    out[length++] = digits[0];
+    return length;
+}
+
+// Function to write "location rainfall temperature\n" like the data.txt format, returns its length
+int formatStationText(char *out, const char *location, float rainfall, float temperature)
+{
+    size_t nameLength = strlen(location);
+    int length = (int)nameLength;
+
+    memcpy(out, location, nameLength);
+    out[length++] = ' ';
+    length += formatFixed2(out + length, rainfall);
+    out[length++] = ' ';
+    length += formatFixed2(out + length, temperature);
+    out[length++] = '\n';
+    out[length] = '\0';
+    return length;
+}
+
+// Function to write "location rainfall temperature water_level ON|OFF\n" like the predictions.txt format
+int formatPredictionText(char *out, const char *location, float rainfall, float temperature, float waterLevel, int alert)
+{
+    int length = formatStationText(out, location, rainfall, temperature) - 1; // drop the newline
+    out[length++] = ' ';
+    length += formatFixed2(out + length, waterLevel);
+    memcpy(out + length, alert ? " ON\n" : " OFF\n", alert ? 5 : 6); // NUL included
+    return length + (alert ? 4 : 5);
+}
+
+// Function to make room for at least `bytes` more characters, returns 0 when out of memory
+int reserveText(TextBuffer *buffer, size_t bytes)
+{
+    if (buffer->capacity - buffer->length >= bytes)
+    {
+        return 1;
+    }
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 1 << 16;
+    while (capacity - buffer->length < bytes)
+    {
+        capacity *= 2;
+    }
+    char *grown = realloc(buffer->data, capacity);
+    if (grown == NULL)
+    {
+        return 0;
+    }
+    buffer->data = grown;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+///////////////// END ///////////////////////////
+
+///////////////////////// 232-35-048/////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////// code for load and saving file/////////////////
+
+// Function to save environmental data to a file
+void saveDataToFile(const EnvironmentalData *data, int count)
+{
+    FILE *file = fopen("data_base/data.txt", "a"); // Open file in append mode
+    if (file == NULL)
+    {
+        printf("Error opening file for writing.\n");
+        return;
+    }
+    // Write each entry to the file
+    for (int i = 0; i < count; i++)
+    {
+        fprintf(file, "%s %.2f %.2f\n", data[i].location, data[i].rainfall, data[i].temperature);
+    }
+    fclose(file);
+    printf("\033[1;32m"); // Green for success
+    printf("Data saved successfully to data.txt.\n");
+    printf("\033[0m"); // Reset color
+}
+
+// Function to round a value to what the text files store (two decimals), so the
+// resident table always matches what a restart would load
+float roundToStored(float value)
+{
+    char text[64];
+    text[formatFixed2(text, value)] = '\0';
+    return strtof(text, NULL);
+}
+
+// Function to remember a changed station so only its prediction row gets recomputed
+void recordStationChange(const char *location)
+{
+    for (int i = 0; i < pendingChangeCount; i++)
+    {
+        if (compareLocations(pendingChanges[i], location) == 0)
+        {
+            return; // already pending
+        }
+    }
+    if (pendingChangeCount >= MAX_PENDING_CHANGES)
+    {
+        pendingChangesOverflowed = 1; // too many to patch, predictions get rebuilt instead
+        return;
+    }
+    strcpy(pendingChanges[pendingChangeCount++], location);
+}
+
+// Function to checksum a block of bytes (FNV-1a taken a 64-bit word at a time)
+unsigned long long checksumBytes(const void *data, size_t length)
+{
+    const unsigned char *bytes = data;
+    unsigned long long hash = 1469598103934665603ULL ^ length;
+    size_t i = 0;
+
+    for (; i + 8 <= length; i += 8)
+    {
+        unsigned long long word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < length; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Function to get the size and modification time of a file (-1, -1 when it does not exist)
+void fileStamp(const char *path, long long *size, long long *time)
+{
+    struct stat info;
+    if (stat(path, &info) != 0)
+    {
+        *size = -1;
+        *time = -1;
+        return;
+    }
+    *size = (long long)info.st_size;
+#if defined(__APPLE__)
+    *time = (long long)info.st_mtimespec.tv_sec * 1000000000LL + info.st_mtimespec.tv_nsec; // nanoseconds
+#elif defined(_WIN32)
+    *time = (long long)info.st_mtime;
+#else
+    *time = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+}
+
+// Function to check whether a file exists
+int fileExists(const char *path)
+{
+    struct stat info;
+    return stat(path, &info) == 0;
+}
+
+// Function to push a file's buffered data to disk
+void syncFile(FILE *file)
+{
+    fflush(file);
+#ifndef _WIN32
+    fsync(fileno(file));
+#endif
+}
+
+// Function to format the station table as data.txt content in one memory buffer
+char *formatStationSnapshot(size_t *length)
+{
+    TextBuffer snapshot = {NULL, 0, 0};
+    if (!reserveText(&snapshot, (size_t)count * 24 + MAX_ROW_LENGTH)) // typical row size, grown as needed
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!reserveText(&snapshot, MAX_ROW_LENGTH))
+        {
+            free(snapshot.data);
+            return NULL;
+        }
+        snapshot.length += formatStationText(snapshot.data + snapshot.length, stations.location[i], stations.rainfall[i], stations.temperature[i]);
+    }
+    *length = snapshot.length;
+    return snapshot.data;
+}
+
+// Function to move a fully written temporary file over path, so readers never see a half-written file
+int replaceFile(const char *temp, const char *path)
+{
+#ifdef _WIN32
+    remove(path); // rename doesn't replace an existing file on Windows
+#endif
+    return rename(temp, path) == 0;
+}
+
+// Function to replace data.txt with a snapshot; written to a temp file first so a crash never truncates it
+int writeStationSnapshot(const char *snapshot, size_t length)
+{
+    char temp[256];
+    snprintf(temp, sizeof(temp), "%s.tmp", input_file);
+
+    FILE *file = fopen(temp, "wb");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    int ok = fwrite(snapshot, 1, length, file) == length;
+    syncFile(file);
+    fclose(file);
+
+    return ok && replaceFile(temp, input_file);
+}
+
+// Function to append one file to another (used to fold a log into the rotated log)
+int appendFileTo(const char *source, const char *destination)
+{
+    FILE *in = fopen(source, "rb");
+    if (in == NULL)
+    {
+        return 1; // nothing to append
+    }
+    FILE *out = fopen(destination, "ab");
+    if (out == NULL)
+    {
+        fclose(in);
+        return 0;
+    }
+
+    char buffer[8192];
+    size_t read;
+    int ok = 1;
+    while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    {
+        ok = ok && fwrite(buffer, 1, read, out) == read;
+    }
+    syncFile(out);
+    fclose(out);
+    fclose(in);
+    return ok;
+}
+
+///////////////////// END ////////////////////////////
+
+//////////// ROLLING RAINFALL WINDOWS /////////////////
+/*
+Each history series keeps the rainfall of its last RAIN_WINDOW_HOURS hours in an
+hourly ring, plus running sums over the last 24 h, 72 h and 7 days. An
+observation adds to its hour's bucket and to the sums; moving to a new hour
+subtracts the bucket that leaves each window, so the sums never rescan history.
+Amounts are kept in hundredths of a millimetre (what the text files store), so
+adding and subtracting never drifts.
+*/
+
+const int rainfallWindowHours[RAIN_WINDOWS] = {24, 72, RAIN_WINDOW_HOURS};
+
+// Function to move a window's newest hour forward, dropping the hours that leave each sum
+void advanceRainfallWindow(RainfallWindow *window, long long hour)
+{
+    if (hour - window->hour >= RAIN_WINDOW_HOURS)
+    {
+        memset(window->bucket, 0, sizeof(window->bucket)); // every hour has left the ring
+        memset(window->sum, 0, sizeof(window->sum));
+        window->hour = hour;
+        return;
+    }
+    while (window->hour < hour)
+    {
+        long long next = ++window->hour;
+        for (int w = 0; w < RAIN_WINDOWS; w++)
+        {
+            window->sum[w] -= window->bucket[(next - rainfallWindowHours[w]) % RAIN_WINDOW_HOURS];
+        }
+        window->bucket[next % RAIN_WINDOW_HOURS] = 0; // the slot of next - RAIN_WINDOW_HOURS
+    }
+}
+
+// Function to add an observation's rainfall to the window of its series
+void addRainfallObservation(RainfallWindow *window, long long time, float rainfall)
+{
+    long long hour = time / 3600;
+    long long amount = (long long)(rainfall * 100.0 + (rainfall < 0 ? -0.5 : 0.5)); // hundredths of a mm
+
+    if (hour > window->hour)
+    {
+        advanceRainfallWindow(window, hour);
+    }
+    for (int w = 0; w < RAIN_WINDOWS; w++)
+    {
+        if (hour > window->hour - rainfallWindowHours[w])
+        {
+            window->sum[w] += amount;
+        }
+    }
+    if (hour > window->hour - RAIN_WINDOW_HOURS)
+    {
+        window->bucket[hour % RAIN_WINDOW_HOURS] += amount;
+    }
+}
+
+// Function to read a window's sums as of the hour of `now` without changing it,
+// so the prediction threads can share the windows
+void readRainfallWindow(const RainfallWindow *window, long long now, float sums[RAIN_WINDOWS])
+{
+    long long gap = now / 3600 - window->hour;
+    for (int w = 0; w < RAIN_WINDOWS; w++)
+    {
+        long long sum = 0;
+        if (gap < rainfallWindowHours[w])
+        {
+            sum = window->sum[w];
+            for (long long h = 1; h <= gap; h++)
+            {
+                sum -= window->bucket[(window->hour + h - rainfallWindowHours[w]) % RAIN_WINDOW_HOURS];
+            }
+        }
+        sums[w] = sum / 100.0f;
+    }
+}
+
+///////////////////// END ////////////////////////////
+
+//////////// OBSERVATION HISTORY /////////////////
+/*
+Every observation an admin enters is kept as (time, rainfall, temperature) in a
+per-station series, so data.txt keeps only the latest values but nothing is lost.
+A series is a list of chunks of up to HISTORY_CHUNK_POINTS points, each a
+Gorilla-style bit stream:
+  time:   first point raw (64 bits), then the delta-of-delta of the timestamps:
+          '0' for the same step, '10'+7, '110'+9, '1110'+12 or '1111'+64 bits
+  values: first point raw (32 bits), then the XOR with the previous value:
+          '0' when unchanged, '10' + the meaningful bits when they fit the
+          previous window, else '11' + 5 bits leading zeros + 5 bits length-1 + bits
+Hourly readings cost a few bytes per point instead of 16. Chunks are appended to
+data_base/history.bin once full (and at exit for the open ones); the points of
+the open chunks are journaled to data_base/history.wal as they arrive. The
+journal is only flushed: the station log record of the same edit carries the
+timestamp and is the one synced, so a journal tail lost in a crash is put back
+from the log at startup and a crash loses nothing. Timestamps of a series only increase, which lets a replay
+skip what history.bin already holds.
+*/
+
+// Function to count the leading zero bits of a non-zero 32-bit value
+int leadingZeros32(unsigned int value)
+{
+#ifdef __GNUC__
+    return __builtin_clz(value);
+#else
+    int zeros = 0;
+    while (!(value & 0x80000000u))
+    {
+        value <<= 1;
+        zeros++;
+    }
+    return zeros;
+#endif
+}
+
+// Function to count the trailing zero bits of a non-zero 32-bit value
+int trailingZeros32(unsigned int value)
+{
+#ifdef __GNUC__
+    return __builtin_ctz(value);
+#else
+    int zeros = 0;
+    while (!(value & 1u))
+    {
+        value >>= 1;
+        zeros++;
+    }
+    return zeros;
+#endif
+}
+
+// Function to append the low `width` bits of value to a chunk's bit stream (most significant bit first)
+int appendBits(HistoryChunk *chunk, unsigned long long value, int width)
+{
+    size_t needed = (chunk->bitLength + (size_t)width + 7) / 8;
+    if (needed > chunk->byteCapacity)
+    {
+        size_t capacity = chunk->byteCapacity ? chunk->byteCapacity * 2 : 64;
+        while (capacity < needed)
+        {
+            capacity *= 2;
+        }
+        unsigned char *grown = realloc(chunk->bits, capacity);
+        if (grown == NULL)
+        {
+            return 0;
+        }
+        memset(grown + chunk->byteCapacity, 0, capacity - chunk->byteCapacity);
+        chunk->bits = grown;
+        chunk->byteCapacity = capacity;
+    }
+
+    while (width > 0)
+    {
+        int room = 8 - (int)(chunk->bitLength & 7);
+        int take = width < room ? width : room;
+        unsigned int part = (unsigned int)(value >> (width - take)) & ((1u << take) - 1);
+        chunk->bits[chunk->bitLength >> 3] |= (unsigned char)(part << (room - take));
+        chunk->bitLength += take;
+        width -= take;
+    }
+    return 1;
+}
+
+// Function to read `width` bits from a bit stream, advancing position
+unsigned long long readBits(const unsigned char *bits, size_t *position, int width)
+{
+    unsigned long long value = 0;
+    while (width > 0)
+    {
+        int room = 8 - (int)(*position & 7);
+        int take = width < room ? width : room;
+        unsigned int part = (bits[*position >> 3] >> (room - take)) & ((1u << take) - 1);
+        value = (value << take) | part;
+        *position += take;
+        width -= take;
+    }
+    return value;
+}
+
+// Function to encode one value as the XOR with the previous value of its column
+int encodeHistoryValue(HistoryChunk *chunk, int column, unsigned int value)
+{
+    GorillaState *state = &chunk->state;
+    unsigned int difference = value ^ state->value[column];
+    state->value[column] = value;
+
+    if (difference == 0)
+    {
+        return appendBits(chunk, 0, 1);
+    }
+    int leading = leadingZeros32(difference);
+    int trailing = trailingZeros32(difference);
+    int previousLeading = state->leading[column], previousLength = state->length[column];
+
+    if (previousLength > 0 && leading >= previousLeading && trailing >= 32 - previousLeading - previousLength)
+    {
+        // the meaningful bits fit the previous window
+        return appendBits(chunk, 2, 2) &&
+               appendBits(chunk, difference >> (32 - previousLeading - previousLength), previousLength);
+    }
+
+    int length = 32 - leading - trailing;
+    state->leading[column] = leading;
+    state->length[column] = length;
+    return appendBits(chunk, 3, 2) && appendBits(chunk, (unsigned long long)leading, 5) &&
+           appendBits(chunk, (unsigned long long)(length - 1), 5) && appendBits(chunk, difference >> trailing, length);
+}
+
+// Function to decode one value encoded by encodeHistoryValue
+unsigned int decodeHistoryValue(const unsigned char *bits, size_t *position, GorillaState *state, int column)
+{
+    if (readBits(bits, position, 1) == 0)
+    {
+        return state->value[column];
+    }
+    if (readBits(bits, position, 1) == 1)
+    {
+        state->leading[column] = (int)readBits(bits, position, 5);
+        state->length[column] = (int)readBits(bits, position, 5) + 1;
+    }
+    int shift = 32 - state->leading[column] - state->length[column];
+    state->value[column] ^= (unsigned int)readBits(bits, position, state->length[column]) << shift;
+    return state->value[column];
+}
+
+// Function to append one point to a chunk; the caller checks that the time increases
+int encodeHistoryPoint(HistoryChunk *chunk, long long time, float rainfall, float temperature)
+{
+    unsigned int values[2];
+    memcpy(&values[0], &rainfall, sizeof(float));
+    memcpy(&values[1], &temperature, sizeof(float));
+    GorillaState *state = &chunk->state;
+
+    int ok;
+    if (chunk->points == 0)
+    {
+        ok = appendBits(chunk, (unsigned long long)time, 64) && appendBits(chunk, values[0], 32) &&
+             appendBits(chunk, values[1], 32);
+        state->value[0] = values[0];
+        state->value[1] = values[1];
+        chunk->firstTime = time;
+    }
+    else
+    {
+        long long delta = time - state->time;
+        long long deltaOfDelta = delta - state->delta;
+        state->delta = delta;
+
+        if (deltaOfDelta == 0)
+        {
+            ok = appendBits(chunk, 0, 1);
+        }
+        else if (deltaOfDelta >= -63 && deltaOfDelta <= 64)
+        {
+            ok = appendBits(chunk, 2, 2) && appendBits(chunk, (unsigned long long)(deltaOfDelta + 63), 7);
+        }
+        else if (deltaOfDelta >= -255 && deltaOfDelta <= 256)
+        {
+            ok = appendBits(chunk, 6, 3) && appendBits(chunk, (unsigned long long)(deltaOfDelta + 255), 9);
+        }
+        else if (deltaOfDelta >= -2047 && deltaOfDelta <= 2048)
+        {
+            ok = appendBits(chunk, 14, 4) && appendBits(chunk, (unsigned long long)(deltaOfDelta + 2047), 12);
+        }
+        else
+        {
+            ok = appendBits(chunk, 15, 4) && appendBits(chunk, (unsigned long long)deltaOfDelta, 64);
+        }
+        ok = ok && encodeHistoryValue(chunk, 0, values[0]) && encodeHistoryValue(chunk, 1, values[1]);
+    }
+
+    state->time = time;
+    chunk->lastTime = time;
+    chunk->points++;
+    return ok;
+}
+
+// Function to decode the next point of a chunk; state starts zeroed at position 0
+void decodeHistoryPoint(const HistoryChunk *chunk, size_t *position, GorillaState *state, int first, Observation *point)
+{
+    const unsigned char *bits = chunk->bits;
+    if (first)
+    {
+        state->time = (long long)readBits(bits, position, 64);
+        state->value[0] = (unsigned int)readBits(bits, position, 32);
+        state->value[1] = (unsigned int)readBits(bits, position, 32);
+    }
+    else
+    {
+        long long deltaOfDelta;
+        if (readBits(bits, position, 1) == 0)
+        {
+            deltaOfDelta = 0;
+        }
+        else if (readBits(bits, position, 1) == 0)
+        {
+            deltaOfDelta = (long long)readBits(bits, position, 7) - 63;
+        }
+        else if (readBits(bits, position, 1) == 0)
+        {
+            deltaOfDelta = (long long)readBits(bits, position, 9) - 255;
+        }
+        else if (readBits(bits, position, 1) == 0)
+        {
+            deltaOfDelta = (long long)readBits(bits, position, 12) - 2047;
+        }
+        else
+        {
+            deltaOfDelta = (long long)readBits(bits, position, 64);
+        }
+        state->delta += deltaOfDelta;
+        state->time += state->delta;
+        decodeHistoryValue(bits, position, state, 0);
+        decodeHistoryValue(bits, position, state, 1);
+    }
+
+    point->time = state->time;
+    memcpy(&point->rainfall, &state->value[0], sizeof(float));
+    memcpy(&point->temperature, &state->value[1], sizeof(float));
+}
+
+// Function to find the series of a location, creating it when create is set (NULL if none)
+HistorySeries *findHistorySeries(const char *location, int create)
+{
+    if (historyIndexCapacity > 0)
+    {
+        unsigned int bucket = hashLocation(location) & (historyIndexCapacity - 1);
+        while (historyIndex[bucket] != 0)
+        {
+            HistorySeries *series = &historySeries[historyIndex[bucket] - 1];
+            if (compareLocations(series->location, location) == 0)
+            {
+                return series;
+            }
+            bucket = (bucket + 1) & (historyIndexCapacity - 1);
+        }
+    }
+    if (!create)
+    {
+        return NULL;
+    }
+
+    if (historySeriesCount == historySeriesCapacity)
+    {
+        int capacity = historySeriesCapacity ? historySeriesCapacity * 2 : 256;
+        if (!growColumn((void **)&historySeries, sizeof(HistorySeries), capacity))
+        {
+            return NULL;
+        }
+        historySeriesCapacity = capacity;
+    }
+    if ((unsigned int)(historySeriesCount + 1) * 2 > historyIndexCapacity)
+    {
+        // keep the index at most half full; series never move, so rehash their positions
+        unsigned int capacity = historyIndexCapacity ? historyIndexCapacity * 2 : 512;
+        int *index = calloc(capacity, sizeof(int));
+        if (index == NULL)
+        {
+            return NULL;
+        }
+        for (int i = 0; i < historySeriesCount; i++)
+        {
+            unsigned int bucket = hashLocation(historySeries[i].location) & (capacity - 1);
+            while (index[bucket] != 0)
+            {
+                bucket = (bucket + 1) & (capacity - 1);
+            }
+            index[bucket] = i + 1;
+        }
+        free(historyIndex);
+        historyIndex = index;
+        historyIndexCapacity = capacity;
+    }
+
+    HistorySeries *series = &historySeries[historySeriesCount];
+    memset(series, 0, sizeof(*series));
+    strncpy(series->location, location, MAX_LOCATION_LENGTH - 1);
+    unsigned int bucket = hashLocation(location) & (historyIndexCapacity - 1);
+    while (historyIndex[bucket] != 0)
+    {
+        bucket = (bucket + 1) & (historyIndexCapacity - 1);
+    }
+    historyIndex[bucket] = ++historySeriesCount;
+    return series;
+}
+
+// Function to get the time of the newest point of a series (-1 when it is empty)
+long long lastHistoryTime(const HistorySeries *series)
+{
+    return series->chunkCount > 0 ? series->chunks[series->chunkCount - 1].lastTime : -1;
+}
+
+// Function to get the on-disk size of a chunk block
+long long historyBlockSize(const HistoryChunk *chunk)
+{
+    return (long long)sizeof(HistoryBlock) + (long long)((chunk->bitLength + 7) / 8);
+}
+
+// Function to append a chunk to history.bin; a chunk written before (while it was still open)
+// is written again whole and its older block is superseded
+int writeHistoryChunk(FILE *file, const HistorySeries *series, HistoryChunk *chunk)
+{
+    HistoryBlock block;
+    memset(&block, 0, sizeof(block));
+    memcpy(block.magic, "FHCK", 4);
+    block.points = (unsigned int)chunk->points;
+    block.firstTime = chunk->firstTime;
+    block.lastTime = chunk->lastTime;
+    block.state = chunk->state;
+    block.bitLength = (unsigned long long)chunk->bitLength;
+    memcpy(block.location, series->location, MAX_LOCATION_LENGTH);
+
+    size_t bytes = (chunk->bitLength + 7) / 8;
+    block.checksum = checksumBytes(chunk->bits, bytes);
+    block.headerChecksum = checksumBytes(&block, offsetof(HistoryBlock, headerChecksum));
+
+    if (fwrite(&block, sizeof(block), 1, file) != 1 || fwrite(chunk->bits, 1, bytes, file) != bytes)
+    {
+        return 0;
+    }
+    if (chunk->persistedPoints > 0)
+    {
+        historySupersededBytes += historyBlockSize(chunk); // about the size of the older block
+    }
+    chunk->persistedPoints = chunk->points;
+    return 1;
+}
+
+// Function to append one chunk to history.bin and make it durable
+int persistHistoryChunk(HistorySeries *series, HistoryChunk *chunk)
+{
+    FILE *file = fopen(history_file, "ab");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    int ok = writeHistoryChunk(file, series, chunk);
+    syncFile(file);
+    fclose(file);
+    return ok;
+}
+
+// Function to add a point to a series, sealing the open chunk once it is full.
+// Returns 0 if the time doesn't follow the newest point or memory runs out.
+int appendHistoryPoint(HistorySeries *series, long long time, float rainfall, float temperature)
+{
+    if (time <= lastHistoryTime(series))
+    {
+        return 0;
+    }
+
+    HistoryChunk *chunk = series->chunkCount > 0 ? &series->chunks[series->chunkCount - 1] : NULL;
+    if (chunk == NULL || chunk->points >= HISTORY_CHUNK_POINTS)
+    {
+        if (series->chunkCount == series->chunkCapacity)
+        {
+            int capacity = series->chunkCapacity ? series->chunkCapacity * 2 : 4;
+            if (!growColumn((void **)&series->chunks, sizeof(HistoryChunk), capacity))
+            {
+                return 0;
+            }
+            series->chunkCapacity = capacity;
+        }
+        chunk = &series->chunks[series->chunkCount++];
+        memset(chunk, 0, sizeof(*chunk));
+    }
+
+    if (!encodeHistoryPoint(chunk, time, rainfall, temperature))
+    {
+        return 0;
+    }
+    if (series->rainfall == NULL && (series->rainfall = calloc(1, sizeof(RainfallWindow))) != NULL)
+    {
+        series->rainfall->hour = time / 3600;
+    }
+    if (series->rainfall != NULL)
+    {
+        addRainfallObservation(series->rainfall, time, rainfall);
+    }
+    if (chunk->points == HISTORY_CHUNK_POINTS)
+    {
+        // sealed: trim the stream to its size and write it out
+        unsigned char *trimmed = realloc(chunk->bits, (chunk->bitLength + 7) / 8);
+        if (trimmed != NULL)
+        {
+            chunk->bits = trimmed;
+            chunk->byteCapacity = (chunk->bitLength + 7) / 8;
+        }
+        if (historyLoaded)
+        {
+            persistHistoryChunk(series, chunk);
+        }
+    }
+    return 1;
+}
+
+// Function to record a new observation of a station, timestamped now.
+// Returns the timestamp, 0 if the point could not be kept.
+long long recordObservation(const char *location, float rainfall, float temperature)
+{
+    HistorySeries *series = findHistorySeries(location, 1);
+    if (series == NULL)
+    {
+        return 0;
+    }
+    long long now = (long long)time(NULL);
+    if (now <= lastHistoryTime(series))
+    {
+        now = lastHistoryTime(series) + 1; // two readings in the same second, or the clock went back
+    }
+
+    if (historyJournal == NULL)
+    {
+        historyJournal = fopen(history_journal, "a");
+    }
+    if (historyJournal != NULL)
+    {
+        fprintf(historyJournal, "%s %lld %.2f %.2f\n", series->location, now, rainfall, temperature);
+#ifdef USE_RECORD_STORE
+        syncFile(historyJournal); // a station record only keeps the latest values
+#else
+        fflush(historyJournal); // the write-ahead log record carries the timestamp and is synced instead
+#endif
+    }
+    return appendHistoryPoint(series, now, rainfall, temperature) ? now : 0;
+}
+
+// Function to put back an observation replayed from the write-ahead log, unless the series
+// already holds it. Returns 1 if the point was missing.
+int restoreObservation(const char *location, long long time, float rainfall, float temperature)
+{
+    HistorySeries *series = findHistorySeries(location, 1);
+    if (series == NULL || time <= lastHistoryTime(series))
+    {
+        return 0;
+    }
+    if (historyJournal == NULL)
+    {
+        historyJournal = fopen(history_journal, "a");
+    }
+    if (historyJournal != NULL)
+    {
+        fprintf(historyJournal, "%s %lld %.2f %.2f\n", series->location, time, rainfall, temperature);
+    }
+    return appendHistoryPoint(series, time, rainfall, temperature);
+}
+
+// Function to visit the observations of a station with from <= time <= to, oldest first.
+// Returns the number of points visited.
+int scanHistory(const char *location, long long from, long long to, void (*visit)(const Observation *point, void *arg), void *arg)
+{
+    HistorySeries *series = findHistorySeries(location, 0);
+    if (series == NULL || from > to)
+    {
+        return 0;
+    }
+
+    // first chunk that ends at or after `from`
+    int low = 0, high = series->chunkCount;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (series->chunks[middle].lastTime < from)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    int visited = 0;
+    for (int c = low; c < series->chunkCount && series->chunks[c].firstTime <= to; c++)
+    {
+        const HistoryChunk *chunk = &series->chunks[c];
+        GorillaState state;
+        memset(&state, 0, sizeof(state));
+        size_t position = 0;
+        Observation point;
+
+        for (int i = 0; i < chunk->points; i++)
+        {
+            decodeHistoryPoint(chunk, &position, &state, i == 0, &point);
+            if (point.time > to)
+            {
+                break;
+            }
+            if (point.time >= from)
+            {
+                visit(&point, arg);
+                visited++;
+            }
+        }
+    }
+    return visited;
+}
+
+// Function to rewrite history.bin with exactly the resident chunks, dropping superseded blocks
+int rewriteHistoryFile()
+{
+    char temp[256];
+    snprintf(temp, sizeof(temp), "%s.tmp", history_file);
+
+    FILE *file = fopen(temp, "wb");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    int ok = 1;
+    for (int s = 0; s < historySeriesCount && ok; s++)
+    {
+        for (int c = 0; c < historySeries[s].chunkCount && ok; c++)
+        {
+            ok = writeHistoryChunk(file, &historySeries[s], &historySeries[s].chunks[c]);
+        }
+    }
+    syncFile(file);
+    fclose(file);
+    if (!ok || !replaceFile(temp, history_file))
+    {
+        remove(temp);
+        return 0;
+    }
+    historySupersededBytes = 0;
+    return 1;
+}
+
+// Function to add one scanned observation to a rainfall window
+void seedRainfallWindow(const Observation *point, void *window)
+{
+    addRainfallObservation(window, point->time, point->rainfall);
+}
+
+// Function to get a station's rainfall over the last 24 h, 72 h and 7 d (zeros without history)
+void rollingRainfall(const char *location, long long now, float sums[RAIN_WINDOWS])
+{
+    HistorySeries *series = findHistorySeries(location, 0);
+    if (series == NULL || series->rainfall == NULL)
+    {
+        memset(sums, 0, RAIN_WINDOWS * sizeof(float));
+        return;
+    }
+    readRainfallWindow(series->rainfall, now, sums);
+}
+
+// Function to read history.bin and replay the journal into the resident series.
+// Returns the number of journaled points replayed.
+int loadHistory()
+{
+    FILE *file = fopen(history_file, "rb");
+    int rewrite = 0;
+    long long liveBytes = 0;
+
+    HistoryBlock block;
+    while (file != NULL && fread(&block, sizeof(block), 1, file) == 1)
+    {
+        size_t bytes = (size_t)((block.bitLength + 7) / 8);
+        if (memcmp(block.magic, "FHCK", 4) != 0 ||
+            block.headerChecksum != checksumBytes(&block, offsetof(HistoryBlock, headerChecksum)) ||
+            block.points == 0 || block.points > HISTORY_CHUNK_POINTS)
+        {
+            rewrite = 1; // torn or damaged tail from a crash mid-write
+            break;
+        }
+        unsigned char *bits = malloc(bytes ? bytes : 1);
+        if (bits == NULL || fread(bits, 1, bytes, file) != bytes || checksumBytes(bits, bytes) != block.checksum)
+        {
+            free(bits);
+            rewrite = 1;
+            break;
+        }
+
+        block.location[MAX_LOCATION_LENGTH - 1] = '\0';
+        HistorySeries *series = findHistorySeries(block.location, 1);
+        HistoryChunk *last = series && series->chunkCount > 0 ? &series->chunks[series->chunkCount - 1] : NULL;
+        HistoryChunk *chunk = NULL;
+        if (series == NULL)
+        {
+            // out of memory: the block is skipped
+        }
+        else if (last != NULL && block.firstTime == last->firstTime && (int)block.points >= last->points)
+        {
+            // a later write of the same chunk, with more points
+            historySupersededBytes += historyBlockSize(last);
+            liveBytes -= historyBlockSize(last);
+            free(last->bits);
+            chunk = last;
+        }
+        else if (block.firstTime > lastHistoryTime(series) &&
+                 (series->chunkCount < series->chunkCapacity ||
+                  growColumn((void **)&series->chunks, sizeof(HistoryChunk), series->chunkCapacity ? series->chunkCapacity * 2 : 4)))
+        {
+            if (series->chunkCount == series->chunkCapacity)
+            {
+                series->chunkCapacity = series->chunkCapacity ? series->chunkCapacity * 2 : 4;
+            }
+            chunk = &series->chunks[series->chunkCount++];
+        }
+
+        if (chunk == NULL)
+        {
+            historySupersededBytes += (long long)sizeof(block) + (long long)bytes;
+            free(bits);
+            continue;
+        }
+        memset(chunk, 0, sizeof(*chunk));
+        chunk->firstTime = block.firstTime;
+        chunk->lastTime = block.lastTime;
+        chunk->points = (int)block.points;
+        chunk->persistedPoints = chunk->points;
+        chunk->state = block.state;
+        chunk->bits = bits;
+        chunk->bitLength = (size_t)block.bitLength;
+        chunk->byteCapacity = bytes ? bytes : 1;
+        liveBytes += historyBlockSize(chunk);
+    }
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+    if (rewrite)
+    {
+        rewriteHistoryFile(); // new blocks must not land behind the damaged ones
+    }
+    historyLoaded = 1;
+
+    // Fill the rainfall windows from the last days of each series; from here on appends keep them up to date
+    for (int s = 0; s < historySeriesCount; s++)
+    {
+        HistorySeries *series = &historySeries[s];
+        long long last = lastHistoryTime(series);
+        if (last >= 0 && (series->rainfall = calloc(1, sizeof(RainfallWindow))) != NULL)
+        {
+            series->rainfall->hour = last / 3600;
+            scanHistory(series->location, (last / 3600 - RAIN_WINDOW_HOURS + 1) * 3600, last, seedRainfallWindow, series->rainfall);
+        }
+    }
+
+    // Points of open chunks that only reached the journal before a crash
+    int replayed = 0;
+    file = fopen(history_journal, "r");
+    if (file != NULL)
+    {
+        char line[256], location[MAX_LOCATION_LENGTH];
+        long long time;
+        float rainfall, temperature;
+        while (fgets(line, sizeof(line), file) != NULL)
+        {
+            if (strchr(line, '\n') == NULL || sscanf(line, "%49s %lld %f %f", location, &time, &rainfall, &temperature) != 4)
+            {
+                break; // torn last line
+            }
+            HistorySeries *series = findHistorySeries(location, 1);
+            if (series != NULL && appendHistoryPoint(series, time, rainfall, temperature))
+            {
+                replayed++;
+            }
+        }
+        fclose(file);
+    }
+
+    if (historySupersededBytes > liveBytes / 4)
+    {
+        rewriteHistoryFile();
+    }
+    return replayed;
+}
+
+// Function to write the open chunks out and empty the journal (at exit)
+void flushHistory()
+{
+    if (!historyLoaded)
+    {
+        return;
+    }
+    FILE *file = fopen(history_file, "ab");
+    if (file == NULL)
+    {
+        return;
+    }
+    int ok = 1;
+    for (int s = 0; s < historySeriesCount; s++)
+    {
+        for (int c = 0; c < historySeries[s].chunkCount; c++)
+        {
+            HistoryChunk *chunk = &historySeries[s].chunks[c];
+            if (chunk->points > chunk->persistedPoints)
+            {
+                ok = writeHistoryChunk(file, &historySeries[s], chunk) && ok;
+            }
+        }
+    }
+    syncFile(file);
+    fclose(file);
+
+    if (ok)
+    {
+        // every journaled point is in history.bin now
+        if (historyJournal != NULL)
+        {
+            fclose(historyJournal);
+        }
+        historyJournal = fopen(history_journal, "w");
+        if (historyJournal != NULL)
+        {
+            fclose(historyJournal);
+            historyJournal = NULL;
+        }
+    }
+}
+
+///////////////////// END ////////////////////////////
+
+//////////// FIXED-WIDTH RECORD STORE /////////////////
+/*
+With USE_RECORD_STORE the stations live in data_base/stations.rec: a 64-byte
+header followed by one 64-byte StationRecord per record ID. Each station keeps
+its record ID, so an insert, update or delete is a single pwrite of one record
+at a known offset instead of a log append plus a later compaction. A delete
+leaves a tombstone whose ID goes on an in-memory free list (rebuilt from the
+tombstones at load) and is reused by the next insert. data.txt is exported from
+the table when the predictions need it and at exit; the header remembers the
+data.txt it was last exported to, so a data.txt edited elsewhere is imported
+again instead of being shadowed by the record file.
+*/
+#ifdef USE_RECORD_STORE
+
+// Function to get the file offset of a record
+off_t recordOffset(int id)
+{
+    return (off_t)sizeof(RecordStoreHeader) + (off_t)id * (off_t)sizeof(StationRecord);
+}
+
+// Function to fill the store header, stamped with data.txt as it is on disk now
+void fillRecordHeader(RecordStoreHeader *header)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, "FREC", 4);
+    header->version = RECORD_STORE_VERSION;
+    header->recordSize = sizeof(StationRecord);
+    header->dirty = recordStoreDirty;
+    fileStamp(input_file, &header->exportSize, &header->exportTime);
+}
+
+// Function to fill one record
+void fillStationRecord(StationRecord *record, unsigned int flags, const char *location, float rainfall, float temperature)
+{
+    memset(record, 0, sizeof(*record));
+    record->flags = flags;
+    record->rainfall = rainfall;
+    record->temperature = temperature;
+    strncpy(record->location, location, MAX_LOCATION_LENGTH - 1);
+}
+
+// Function to overwrite one record in place and make it durable
+int writeStationRecord(int id, unsigned int flags, const char *location, float rainfall, float temperature)
+{
+    if (recordFd < 0)
+    {
+        return 0;
+    }
+    StationRecord record;
+    fillStationRecord(&record, flags, location, rainfall, temperature);
+
+    // a record never straddles a 64-byte boundary, so the write lands whole or not at all in practice
+    int ok = pwrite(recordFd, &record, sizeof(record), recordOffset(id)) == (ssize_t)sizeof(record);
+    return fsync(recordFd) == 0 && ok;
+}
+
+// Function to write the store header and make it durable
+int writeRecordHeader()
+{
+    RecordStoreHeader header;
+    fillRecordHeader(&header);
+    int ok = pwrite(recordFd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    return fsync(recordFd) == 0 && ok;
+}
+
+// Function to flag in the header that data.txt no longer matches the records,
+// so a crash before the next export is caught up at startup
+int markRecordStoreDirty()
+{
+    if (recordStoreDirty)
+    {
+        return 1;
+    }
+    recordStoreDirty = 1;
+    return recordFd >= 0 && writeRecordHeader();
+}
+
+// Function to remember a tombstoned record ID for reuse
+int pushFreeRecord(int id)
+{
+    if (freeRecordCount == freeRecordCapacity)
+    {
+        int capacity = freeRecordCapacity ? freeRecordCapacity * 2 : 64;
+        if (!growColumn((void **)&freeRecords, sizeof(int), capacity))
+        {
+            return 0; // the ID is only lost for reuse, the tombstone stays valid
+        }
+        freeRecordCapacity = capacity;
+    }
+    freeRecords[freeRecordCount++] = id;
+    return 1;
+}
+
+// Function to rewrite stations.rec from the resident table (record ID = slot, no tombstones)
+int writeRecordStore()
+{
+    char temp[256];
+    snprintf(temp, sizeof(temp), "%s.tmp", record_file);
+
+    FILE *file = fopen(temp, "wb");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    RecordStoreHeader header;
+    fillRecordHeader(&header);
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int i = 0; i < count && ok; i++)
+    {
+        StationRecord record;
+        fillStationRecord(&record, RECORD_LIVE, stations.location[i], stations.rainfall[i], stations.temperature[i]);
+        ok = fwrite(&record, sizeof(record), 1, file) == 1;
+    }
+    syncFile(file);
+    fclose(file);
+    if (!ok || !replaceFile(temp, record_file))
+    {
+        remove(temp);
+        return 0;
+    }
+
+    if (recordFd >= 0)
+    {
+        close(recordFd);
+    }
+    recordFd = open(record_file, O_RDWR);
+    for (int i = 0; i < count; i++)
+    {
+        stations.recordId[i] = i;
+    }
+    recordCount = count;
+    freeRecordCount = 0;
+    return recordFd >= 0;
+}
+
+// Function to load the stations from stations.rec into the station store.
+// Returns 0 (loading nothing) when the file is missing, not a record store, or
+// data.txt has been changed since the store last exported it.
+int loadRecordStore()
+{
+    int fd = open(record_file, O_RDWR);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    RecordStoreHeader header;
+    long long size, time;
+    fileStamp(input_file, &size, &time);
+    struct stat info;
+    if (fstat(fd, &info) != 0 || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, "FREC", 4) != 0 || header.version != RECORD_STORE_VERSION ||
+        header.recordSize != sizeof(StationRecord) || header.exportSize != size || header.exportTime != time)
+    {
+        close(fd);
+        return 0;
+    }
+
+    // a torn record appended by a crash is ignored and overwritten by the next insert
+    int records = (int)((info.st_size - (off_t)sizeof(header)) / (off_t)sizeof(StationRecord));
+    StationRecord block[1024];
+    for (int first = 0; first < records; first += 1024)
+    {
+        int n = records - first < 1024 ? records - first : 1024;
+        if (pread(fd, block, (size_t)n * sizeof(StationRecord), recordOffset(first)) != (ssize_t)(n * sizeof(StationRecord)))
+        {
+            records = first;
+            break;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            block[i].location[MAX_LOCATION_LENGTH - 1] = '\0';
+            if (block[i].flags != RECORD_LIVE)
+            {
+                pushFreeRecord(first + i);
+                continue;
+            }
+            int slot = appendStation(block[i].location, block[i].rainfall, block[i].temperature);
+            if (slot == -1)
+            {
+                break; // out of memory
+            }
+            stations.recordId[slot] = first + i;
+        }
+    }
+
+    recordFd = fd;
+    recordCount = records;
+    recordStoreDirty = header.dirty != 0; // the last session ended before exporting data.txt
+    return 1;
+}
+
+// Function to export the table to data.txt and stamp the store header with it
+int exportRecordStore()
+{
+    size_t length;
+    char *snapshot = formatStationSnapshot(&length);
+    if (snapshot == NULL)
+    {
+        return 0;
+    }
+    int ok = writeStationSnapshot(snapshot, length);
+    free(snapshot);
+    if (!ok)
+    {
+        return 0;
+    }
+
+    recordStoreDirty = 0;
+    return recordFd < 0 || writeRecordHeader();
+}
+
+// Functions to persist one admin change as a single record write
+int insertStationRecord(int slot)
+{
+    int id = freeRecordCount > 0 ? freeRecords[--freeRecordCount] : recordCount++;
+    stations.recordId[slot] = id;
+    recordStationChange(stations.location[slot]);
+    markRecordStoreDirty();
+    return writeStationRecord(id, RECORD_LIVE, stations.location[slot], stations.rainfall[slot], stations.temperature[slot]);
+}
+
+int updateStationRecord(int slot)
+{
+    recordStationChange(stations.location[slot]);
+    markRecordStoreDirty();
+    return writeStationRecord(stations.recordId[slot], RECORD_LIVE, stations.location[slot], stations.rainfall[slot], stations.temperature[slot]);
+}
+
+int deleteStationRecord(int slot)
+{
+    int id = stations.recordId[slot];
+    recordStationChange(stations.location[slot]);
+    markRecordStoreDirty();
+    if (!writeStationRecord(id, RECORD_DELETED, stations.location[slot], 0, 0))
+    {
+        return 0;
+    }
+    pushFreeRecord(id);
+    return 1;
+}
+
+#endif
+
+///////////////////// END ////////////////////////////
+
+//////////// WRITE-AHEAD LOG FOR STATION MUTATIONS /////////////////
+/*
+Every insert, update and delete is appended to data_base/data.wal as one line:
+    <sequence> <I|U|D> <location> <rainfall> <temperature> [<time>]
+and data.txt is only rewritten when the log is compacted. Compaction rotates the
+log to data.wal.old and writes the snapshot in the background; the old log is
+removed once the snapshot is in place. Records only carry absolute values, so
+replaying a log that is already part of the snapshot gives the same table.
+Inserts and updates also carry the time of the observation they recorded, so
+the history journal doesn't need a sync of its own; it is synced once before
+a compaction drops the records that cover it.
+*/
+
+// Function to apply one replayed log record to the resident table
+void applyLogRecord(char op, const char *location, float rainfall, float temperature)
+{
+    int slot = findLocation(location);
+
+    if (op == 'D')
+    {
+        if (slot != -1)
+        {
+            removeStation(slot);
+        }
+    }
+    else if (slot != -1)
+    {
+        stations.rainfall[slot] = rainfall;
+        stations.temperature[slot] = temperature;
+    }
+    else
+    {
+        insertStation(location, rainfall, temperature);
+    }
+}
+
+// Function to replay one log file, returns the number of records applied
+int replayLogFile(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return 0;
+    }
+
+    char line[256], location[MAX_LOCATION_LENGTH], op;
+    long long sequence, time;
+    float rainfall, temperature;
+    int applied = 0, restored = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strchr(line, '\n') == NULL)
+        {
+            break; // torn last record from a crash mid-append
+        }
+        int fields = sscanf(line, "%lld %c %49s %f %f %lld", &sequence, &op, location, &rainfall, &temperature, &time);
+        if (fields < 2)
+        {
+            break;
+        }
+        if (sequence > walSequence)
+        {
+            walSequence = sequence;
+        }
+        if ((op == 'I' || op == 'U') && fields == 6)
+        {
+            restored += restoreObservation(location, time, rainfall, temperature); // even when the snapshot has the values
+        }
+        if (sequence <= snapshotSequence)
+        {
+            continue; // already part of the table loaded from the binary snapshot
+        }
+        if ((op == 'I' || op == 'U') && fields >= 5)
+        {
+            applyLogRecord(op, location, rainfall, temperature);
+            applied++;
+        }
+        else if (op == 'D' && fields >= 3)
+        {
+            applyLogRecord(op, location, 0, 0);
+            applied++;
+        }
+        // 'C' is the checkpoint written after a rotation, it only carries the sequence
+    }
+
+    fclose(file);
+    if (restored > 0 && historyJournal != NULL)
+    {
+        syncFile(historyJournal); // the compaction that follows drops these records
+    }
+    return applied;
+}
+
+// Function to replay the logs on top of the loaded data.txt and open the log for appending.
+// Returns the number of records replayed.
+int recoverStationLog()
+{
+    char rotated[256];
+    snprintf(rotated, sizeof(rotated), "%s.old", log_file);
+
+#ifdef USE_RECORD_STORE
+    if (recordFd >= 0)
+    {
+        return recordStoreDirty; // loaded from stations.rec; 1 if data.txt still has to catch up with it
+    }
+#endif
+    int applied = replayLogFile(rotated); // left behind by an unfinished compaction
+    applied += replayLogFile(log_file);
+
+#ifdef USE_RECORD_STORE
+    // Move the imported data.txt and anything a log-based build left behind into a new record store
+    recordStoreDirty = applied > 0;
+    if (writeRecordStore())
+    {
+        remove(rotated);
+        remove(log_file);
+    }
+#else
+    walFile = fopen(log_file, "a");
+#endif
+    return applied;
+}
+
+// Function to append one mutation to the log and make it durable; time is the
+// observation recorded with it, 0 for none
+int logStationMutation(char op, const char *location, float rainfall, float temperature, long long time)
+{
+    if (walFile == NULL)
+    {
+        walFile = fopen(log_file, "a");
+        if (walFile == NULL)
+        {
+            return 0;
+        }
+    }
+
+    walSequence++;
+    walRecords++;
+    int ok = time > 0 ? fprintf(walFile, "%lld %c %s %.2f %.2f %lld\n", walSequence, op, location, rainfall, temperature, time) > 0
+                      : fprintf(walFile, "%lld %c %s %.2f %.2f\n", walSequence, op, location, rainfall, temperature) > 0;
+    syncFile(walFile);
+    return ok;
+}
+
+// Function to write a compaction snapshot and drop the rotated log it covers
+void *runCompaction(void *argument)
+{
+    char rotated[256];
+    snprintf(rotated, sizeof(rotated), "%s.old", log_file);
+
+    if (writeStationSnapshot(compactionSnapshot, compactionLength))
+    {
+        remove(rotated);
+    }
+    free(compactionSnapshot);
+    compactionSnapshot = NULL;
+    return argument;
+}
+
+// Function to wait for a background compaction to finish
+void waitForCompaction()
+{
+#ifndef _WIN32
+    if (compactionRunning)
+    {
+        pthread_join(compactionThread, NULL);
+    }
+#endif
+    compactionRunning = 0;
+}
+
+// Function to compact the log into a new data.txt snapshot.
+// With wait = 0 the snapshot is written by a background thread.
+int compactStationLog(int wait)
+{
+#ifdef USE_RECORD_STORE
+    (void)wait;
+    return !recordStoreDirty || exportRecordStore(); // no log to fold, only bring data.txt up to date
+#else
+    char rotated[256];
+    snprintf(rotated, sizeof(rotated), "%s.old", log_file);
+
+    waitForCompaction(); // one compaction at a time
+
+    size_t length;
+    char *snapshot = formatStationSnapshot(&length);
+    if (snapshot == NULL)
+    {
+        return 0;
+    }
+
+    // The history points of the rotated records must not depend on them any more
+    if (historyJournal != NULL)
+    {
+        syncFile(historyJournal);
+    }
+
+    // Rotate the log: everything logged so far stays replayable in data.wal.old until the snapshot is in place
+    if (walFile != NULL)
+    {
+        fclose(walFile);
+    }
+    int rotatedOk;
+    if (fileExists(rotated))
+    {
+        // an earlier snapshot failed and its log is still there: fold the current log into it
+        rotatedOk = appendFileTo(log_file, rotated) && (remove(log_file) == 0 || !fileExists(log_file));
+    }
+    else
+    {
+        rotatedOk = rename(log_file, rotated) == 0 || !fileExists(log_file);
+    }
+    walFile = fopen(log_file, rotatedOk ? "w" : "a");
+    if (walFile != NULL && rotatedOk)
+    {
+        fprintf(walFile, "%lld C\n", walSequence); // checkpoint keeps the sequence monotonic
+        syncFile(walFile);
+    }
+    if (!rotatedOk)
+    {
+        free(snapshot);
+        return 0;
+    }
+    walRecords = 0;
+
+    compactionSnapshot = snapshot;
+    compactionLength = length;
+#ifndef _WIN32
+    if (!wait && pthread_create(&compactionThread, NULL, runCompaction, NULL) == 0)
+    {
+        compactionRunning = 1;
+        return 1;
+    }
+#endif
+    runCompaction(NULL);
+    return 1;
+#endif
+}
+
+// Function to log a mutation, compacting first once the log has grown long enough
+int storeStationMutation(char op, const char *location, float rainfall, float temperature, long long time)
+{
+    recordStationChange(location);
+
+    if (walRecords >= WAL_COMPACT_RECORDS)
+    {
+        compactStationLog(0);
+    }
+    return logStationMutation(op, location, rainfall, temperature, time);
+}
+
+// Functions used by the admin operations to persist a change
+int storeInsertedStation(int slot)
+{
+#ifdef USE_RECORD_STORE
+    recordObservation(stations.location[slot], stations.rainfall[slot], stations.temperature[slot]);
+    return insertStationRecord(slot);
+#else
+    long long time = recordObservation(stations.location[slot], stations.rainfall[slot], stations.temperature[slot]);
+    return storeStationMutation('I', stations.location[slot], stations.rainfall[slot], stations.temperature[slot], time);
+#endif
+}
+
+int storeUpdatedStation(int slot)
+{
+#ifdef USE_RECORD_STORE
+    recordObservation(stations.location[slot], stations.rainfall[slot], stations.temperature[slot]);
+    return updateStationRecord(slot);
+#else
+    long long time = recordObservation(stations.location[slot], stations.rainfall[slot], stations.temperature[slot]);
+    return storeStationMutation('U', stations.location[slot], stations.rainfall[slot], stations.temperature[slot], time);
+#endif
+}
+
+int storeDeletedStation(int slot)
+{
+#ifdef USE_RECORD_STORE
+    return deleteStationRecord(slot);
+#else
+    return storeStationMutation('D', stations.location[slot], 0, 0, 0);
+#endif
+}
+
+///////////////////// END ////////////////////////////
+
+////////////////////////// THREAD POOL //////////////////////////////
+
+// Function to get how many threads run pool tasks, the calling thread included
+int threadPoolSize()
+{
+#ifdef _WIN32
+    return 1;
+#else
+    int threads = poolThreads;
+    if (threads <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? (int)cores : 1;
+    }
+    return threads < MAX_POOL_THREADS ? threads : MAX_POOL_THREADS;
+#endif
+}
+
+#ifndef _WIN32
+// Function to run pool tasks until none are left (called with poolLock held)
+void runPoolTasks()
+{
+    while (poolNextTask < poolTaskCount)
+    {
+        int task = poolNextTask++;
+        pthread_mutex_unlock(&poolLock);
+        poolTask(task, poolArg);
+        pthread_mutex_lock(&poolLock);
+        if (++poolFinished == poolTaskCount)
+        {
+            pthread_cond_broadcast(&poolDone);
+        }
+    }
+}
+
+// Function run by each pool worker: sleep until a new batch of tasks is posted
+void *poolWorker(void *unused)
+{
+    unsigned int seen = 0;
+    (void)unused;
+
+    pthread_mutex_lock(&poolLock);
+    while (!poolStopping)
+    {
+        if (poolGeneration == seen)
+        {
+            pthread_cond_wait(&poolWake, &poolLock);
+            continue;
+        }
+        seen = poolGeneration;
+        runPoolTasks();
+    }
+    pthread_mutex_unlock(&poolLock);
+    return NULL;
+}
+#endif
+
+// Function to stop the pool workers; the pool restarts on the next runParallel
+void stopThreadPool()
+{
+#ifndef _WIN32
+    pthread_mutex_lock(&poolLock);
+    poolStopping = 1;
+    pthread_cond_broadcast(&poolWake);
+    pthread_mutex_unlock(&poolLock);
+    for (int i = 0; i < poolWorkerCount; i++)
+    {
+        pthread_join(poolWorkers[i], NULL);
+    }
+    poolWorkerCount = 0;
+    poolStopping = 0;
+#endif
+}
+
+// Function to change the number of pool threads (0 = one per online core)
+void setThreadPoolSize(int threads)
+{
+    stopThreadPool();
+    poolThreads = threads;
+}
+
+// Function to run task(0..tasks-1, arg) across the pool and wait for all of them
+void runParallel(int tasks, void (*task)(int task, void *arg), void *arg)
+{
+#ifndef _WIN32
+    int threads = threadPoolSize();
+    if (threads > 1 && tasks > 1)
+    {
+        while (poolWorkerCount < threads - 1 &&
+               pthread_create(&poolWorkers[poolWorkerCount], NULL, poolWorker, NULL) == 0)
+        {
+            poolWorkerCount++;
+        }
+
+        pthread_mutex_lock(&poolLock);
+        poolTask = task;
+        poolArg = arg;
+        poolNextTask = 0;
+        poolTaskCount = tasks;
+        poolFinished = 0;
+        poolGeneration++;
+        pthread_cond_broadcast(&poolWake);
+
+        runPoolTasks(); // the caller works too
+        while (poolFinished < poolTaskCount)
+        {
+            pthread_cond_wait(&poolDone, &poolLock);
+        }
+        pthread_mutex_unlock(&poolLock);
+        return;
+    }
+#endif
+    for (int i = 0; i < tasks; i++)
+    {
+        task(i, arg);
+    }
+}
+
+// Function to run init the first time once is passed in, even when pool tasks get there together
+void runOnce(OnceFlag *once, void (*init)(void))
+{
+#ifdef _WIN32
+    if (!*once)
+    {
+        *once = 1;
+        init();
+    }
+#else
+    pthread_once(once, init);
+#endif
+}
+
+//////////////////////////// END ///////////////////////////////////////
+
+//////////////////////// LINE PARSER ///////////////////////////
+
+// Function to map a whole file read-only, returns 0 when it cannot be mapped.
+// With copyOnWrite the pages are also writable, but writes stay private to this process.
+int mapFile(const char *path, MappedFile *mapped, int copyOnWrite)
+{
+#ifdef _WIN32
+    (void)path;
+    (void)mapped;
+    (void)copyOnWrite;
+    return 0; // callers fall back to buffered reads
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        return 0;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return 0;
+    }
+    mapped->data = NULL;
+    mapped->size = (size_t)info.st_size;
+    if (mapped->size > 0)
+    {
+        void *data = copyOnWrite ? mmap(NULL, mapped->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)
+                                 : mmap(NULL, mapped->size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return 0;
+        }
+        mapped->data = data;
+    }
+    close(fd); // the mapping stays valid
+    return 1;
+#endif
+}
+
+// Function to release a mapping made by mapFile
+void unmapFile(MappedFile *mapped)
+{
+#ifndef _WIN32
+    if (mapped->data != NULL)
+    {
+        munmap((void *)mapped->data, mapped->size);
+    }
+#endif
+    mapped->data = NULL;
+    mapped->size = 0;
+}
+
+// Function to open a file for line-by-line reading, returns 0 when it cannot be opened
+int openLineReader(LineReader *reader, const char *path)
+{
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL)
+    {
+        return 0;
+    }
+    reader->capacity = LINE_READER_BUFFER;
+    reader->data = malloc(reader->capacity);
+    if (reader->data == NULL)
+    {
+        fclose(reader->file);
+        reader->file = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+// Function to close a line reader and free its buffer
+void closeLineReader(LineReader *reader)
+{
+    if (reader->mapped)
+    {
+        MappedFile mapped = {reader->data, reader->size};
+        unmapFile(&mapped);
+    }
+    else
+    {
+        free(reader->data);
+    }
+    if (reader->file != NULL)
+    {
+        fclose(reader->file);
+    }
+    memset(reader, 0, sizeof(*reader));
+}
+
+// Function to read a whole file into memory, for where mapping is not available.
+// The buffer is released with free((void *)contents->data).
+int loadFile(const char *path, MappedFile *contents)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    char *data = malloc(size > 0 ? (size_t)size : 1);
+    contents->size = data != NULL && size > 0 ? fread(data, 1, (size_t)size, file) : 0;
+    contents->data = data;
+    fclose(file);
+    return data != NULL;
+}
+
+// Function to open a file for line-by-line reading straight from a read-only mapping,
+// so repeated reads hit the page cache without copying. Falls back to buffered reads.
+int openMappedLineReader(LineReader *reader, const char *path)
+{
+    MappedFile mapped;
+    if (!mapFile(path, &mapped, 0))
+    {
+        return openLineReader(reader, path);
+    }
+
+    memset(reader, 0, sizeof(*reader));
+    reader->data = (char *)mapped.data;
+    reader->size = mapped.size;
+    reader->capacity = mapped.size;
+    reader->eof = 1;
+    reader->mapped = 1;
+    return 1;
+}
+
+// Function to get the next line, without its newline. Returns 0 at the end of the file.
+// A line longer than the buffer is handed out in buffer-sized pieces, which the row parsers reject.
+int nextLine(LineReader *reader, const char **line, size_t *length)
+{
+    while (1)
+    {
+        char *start = reader->data + reader->position;
+        size_t available = reader->size - reader->position;
+        char *newline = available > 0 ? memchr(start, '\n', available) : NULL;
+
+        if (newline != NULL || reader->eof || (reader->position == 0 && reader->size == reader->capacity))
+        {
+            if (available == 0)
+            {
+                return 0;
+            }
+            *line = start;
+            *length = newline != NULL ? (size_t)(newline - start) : available;
+            reader->position += *length + (newline != NULL);
+            return 1;
+        }
+
+        // Keep the partial line and refill the rest of the buffer
+        memmove(reader->data, start, available);
+        reader->size = available;
+        reader->position = 0;
+        size_t got = fread(reader->data + reader->size, 1, reader->capacity - reader->size, reader->file);
+        reader->size += got;
+        reader->eof = got == 0;
+    }
+}
+
+// Function to check for a field separator (space, tab, CR, vertical tab, form feed)
+int isFieldSpace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// Function to split a line into whitespace-separated fields.
+// Returns the number of fields, or maxFields + 1 when the line has more.
+int splitFields(const char *line, size_t length, TextField *fields, int maxFields)
+{
+    const char *p = line, *end = line + length;
+    int found = 0;
+
+    while (1)
+    {
+        while (p < end && isFieldSpace(*p))
+        {
+            p++;
+        }
+        if (p == end)
+        {
+            return found;
+        }
+        if (found == maxFields)
+        {
+            return maxFields + 1;
+        }
+        fields[found].start = p;
+        while (p < end && !isFieldSpace(*p))
+        {
+            p++;
+        }
+        fields[found].length = (size_t)(p - fields[found].start);
+        found++;
+    }
+}
+
+// Function to parse a whole field as a float, returns 0 when it is not a number.
+// Plain decimals with at most 2^24 as digits and 10 fraction digits are converted with a single
+// float division of two exact values, which rounds exactly like strtof (Clinger's fast path).
+// Anything else (exponents, long mantissas, inf/nan) goes through strtof.
+int parseFloatField(const TextField *field, float *value)
+{
+    static const float exactPowersOfTen[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    const char *p = field->start, *end = field->start + field->length;
+    int negative = 0, digits = 0, fraction = 0, exact = 1;
+    unsigned long mantissa = 0;
+
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        mantissa = mantissa * 10 + (unsigned long)(*p++ - '0');
+        exact = exact && mantissa <= (1UL << 24);
+        mantissa = exact ? mantissa : 0;
+        digits++;
+    }
+    if (p < end && *p == '.')
+    {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            mantissa = mantissa * 10 + (unsigned long)(*p++ - '0');
+            exact = exact && mantissa <= (1UL << 24);
+            mantissa = exact ? mantissa : 0;
+            digits++;
+            fraction++;
+        }
+    }
+
+#if FLT_EVAL_METHOD == 0
+    if (exact && digits > 0 && p == end && fraction <= 10)
+    {
+        float result = (float)mantissa / exactPowersOfTen[fraction];
+        *value = negative ? -result : result;
+        return 1;
+    }
+#endif
+
+    char text[64];
+    char *parsedEnd;
+    if (field->length == 0 || field->length >= sizeof(text))
+    {
+        return 0;
+    }
+    memcpy(text, field->start, field->length);
+    text[field->length] = '\0';
+    *value = strtof(text, &parsedEnd);
+    return parsedEnd == text + field->length;
+}
+
+// Function to copy a field into a NUL-terminated buffer, rejecting fields that do not fit
+int copyField(const TextField *field, char *text, size_t size)
+{
+    if (field->length >= size)
+    {
+        return 0;
+    }
+    memcpy(text, field->start, field->length);
+    text[field->length] = '\0';
+    return 1;
+}
+
+// Function to parse a data.txt line: location rainfall temperature
+int parseStationLine(const char *line, size_t length, char *location, float *rainfall, float *temperature)
+{
+    TextField fields[3];
+    return splitFields(line, length, fields, 3) == 3 &&
+           copyField(&fields[0], location, MAX_LOCATION_LENGTH) &&
+           parseFloatField(&fields[1], rainfall) &&
+           parseFloatField(&fields[2], temperature);
+}
+
+// Function to parse a predictions.txt line: location rainfall temperature water_level alert
+int parsePredictionLine(const char *line, size_t length, ForecastData *forecast)
+{
+    TextField fields[5];
+    return splitFields(line, length, fields, 5) == 5 &&
+           copyField(&fields[0], forecast->location, sizeof(forecast->location)) &&
+           parseFloatField(&fields[1], &forecast->rainfall) &&
+           parseFloatField(&fields[2], &forecast->temperature) &&
+           parseFloatField(&fields[3], &forecast->waterLevel) &&
+           copyField(&fields[4], forecast->alertStatus, sizeof(forecast->alertStatus));
+}
+
+///////////////////// END ////////////////////////////
+
+//////////////////// PARALLEL STATION PARSER ///////////////////////
+
+// Function to find the first line start at or after `position`
+size_t nextLineStart(const char *data, size_t size, size_t position)
+{
+    if (position == 0 || position >= size)
+    {
+        return position < size ? position : size;
+    }
+    const char *newline = memchr(data + position - 1, '\n', size - position + 1);
+    return newline != NULL ? (size_t)(newline - data) + 1 : size;
+}
+
+// Function to count the lines of one chunk, the upper bound of the rows it can hold
+void countStationChunk(int chunk, void *arg)
+{
+    StationParseJob *job = arg;
+    const char *p = job->data + job->start[chunk], *end = job->data + job->start[chunk + 1];
+    int lines = 0;
+
+    while (p < end)
+    {
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        lines++;
+        p = newline != NULL ? newline + 1 : end;
+    }
+    job->parsed[chunk] = lines;
+}
+
+// Function to parse one chunk straight into its range of the columns
+void parseStationChunk(int chunk, void *arg)
+{
+    StationParseJob *job = arg;
+    StationColumns *columns = job->columns;
+    const char *p = job->data + job->start[chunk], *end = job->data + job->start[chunk + 1];
+    int row = job->first[chunk];
+
+    while (p < end)
+    {
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        const char *lineEnd = newline != NULL ? newline : end;
+        if (parseStationLine(p, (size_t)(lineEnd - p), columns->names[row], &columns->rainfall[row], &columns->temperature[row]))
+        {
+            row++;
+        }
+        p = newline != NULL ? newline + 1 : end;
+    }
+    job->parsed[chunk] = row - job->first[chunk];
+}
+
+// Function to free parsed station columns
+void freeStationColumns(StationColumns *columns)
+{
+    free(columns->names);
+    free(columns->rainfall);
+    free(columns->temperature);
+    memset(columns, 0, sizeof(*columns));
+}
+
+// Function to parse a whole data file into columns using the thread pool.
+// The file is cut into byte ranges that start on line boundaries; the lines of each range are
+// counted in parallel, which places every range in the columns, and then parsed in parallel in place.
+// Returns 0 when the file cannot be read or memory runs out.
+int parseStationFile(const char *path, StationColumns *columns)
+{
+    memset(columns, 0, sizeof(*columns));
+
+    MappedFile mapped = {NULL, 0};
+    int isMapped = mapFile(path, &mapped, 0);
+    if (!isMapped && !loadFile(path, &mapped)) // no mapping (e.g. on Windows): read the whole file instead
+    {
+        return 0;
+    }
+
+    StationParseJob job = {mapped.data, mapped.size, 1, NULL, NULL, NULL, columns};
+    int threads = threadPoolSize();
+    while (job.chunks < threads && job.size / (size_t)(job.chunks + 1) >= MIN_PARSE_CHUNK)
+    {
+        job.chunks++;
+    }
+
+    job.start = malloc(((size_t)job.chunks + 1) * sizeof(size_t));
+    job.first = malloc((size_t)job.chunks * sizeof(int));
+    job.parsed = malloc((size_t)job.chunks * sizeof(int));
+    int ok = job.start != NULL && job.first != NULL && job.parsed != NULL;
+
+    if (ok)
+    {
+        for (int i = 0; i <= job.chunks; i++)
+        {
+            job.start[i] = nextLineStart(job.data, job.size, job.size / (size_t)job.chunks * (size_t)i);
+        }
+        job.start[job.chunks] = job.size;
+        runParallel(job.chunks, countStationChunk, &job);
+
+        long long lines = 0;
+        for (int i = 0; i < job.chunks; i++)
+        {
+            job.first[i] = (int)lines;
+            lines += job.parsed[i];
+        }
+        ok = lines < 0x7fffffff;
+        if (ok)
+        {
+            size_t slots = (size_t)lines + 1;
+            columns->names = malloc(slots * MAX_LOCATION_LENGTH);
+            columns->rainfall = malloc(slots * sizeof(float));
+            columns->temperature = malloc(slots * sizeof(float));
+            ok = columns->names != NULL && columns->rainfall != NULL && columns->temperature != NULL;
+        }
+    }
+
+    if (ok)
+    {
+        runParallel(job.chunks, parseStationChunk, &job);
+
+        // Close the gaps left by malformed lines, keeping file order
+        for (int i = 0; i < job.chunks; i++)
+        {
+            if (job.first[i] != columns->rows)
+            {
+                memmove(columns->names[columns->rows], columns->names[job.first[i]], (size_t)job.parsed[i] * MAX_LOCATION_LENGTH);
+                memmove(&columns->rainfall[columns->rows], &columns->rainfall[job.first[i]], (size_t)job.parsed[i] * sizeof(float));
+                memmove(&columns->temperature[columns->rows], &columns->temperature[job.first[i]], (size_t)job.parsed[i] * sizeof(float));
+            }
+            columns->rows += job.parsed[i];
+        }
+    }
+    else
+    {
+        freeStationColumns(columns);
+    }
+
+    free(job.start);
+    free(job.first);
+    free(job.parsed);
+    if (isMapped)
+    {
+        unmapFile(&mapped);
+    }
+    else
+    {
+        free((void *)mapped.data);
+    }
+    return ok;
+}
+
+///////////////////// END ////////////////////////////
+
+//////////// LOAD STATION DATA /////////////////
+
+// Function to load environmental data from a file
+// into the station store (the location index is rebuilt by the caller)
+int loadDataFromFile()
+{
+    StationColumns columns;
+
+#ifdef USE_RECORD_STORE
+    if (loadRecordStore())
+    {
+        return count; // data.txt is only an export of stations.rec
+    }
+#endif
+
+    if (!parseStationFile("data_base/data.txt", &columns))  // If the file doesn't exist
+    {
+        FILE *file;
+        //printf("File doesn't exist. Creating a new file.\n");
+        // Open the file in append mode to create it
+        file = fopen("data_base/data.txt", "a");
+        if (file == NULL)  // Check if the file was successfully created
+        {
+            printf("Error creating the file.\n");
+            return 0; // Indicate failure to create the file
+        }
+        else
+        {
+            fclose(file);  // Close the newly created file
+            return 0;      // Return 0 because no data to load yet
+        }
+    }
+
+    int loaded = 0;
+    // The file was parsed in parallel (malformed lines skipped); append the rows in file order,
+    // the table grows as needed
+    for (int i = 0; i < columns.rows; i++)
+    {
+        if (appendStation(columns.names[i], columns.rainfall[i], columns.temperature[i]) == -1)
+        {
+            break; // out of memory
+        }
+        loaded++;
+    }
+
+    freeStationColumns(&columns);
+    // printf("\033[1;32m"); // Green for success
+    // printf("Data loaded successfully. %d entries read.\n", loaded);
+    // printf("\033[0m"); // Reset color
+
+    return loaded; // Return the number of entries loaded
+}
+///////////////////// END////// END//////////////////////////////
+
+//////// CODE FOR TAKE INPUT////////////
+
+// Function to input data and append to the file
+void inputData()
+{
+    EnvironmentalData entry;
+
+    // Get location input from user
+    printf("\033[1;34m"); // Blue for input prompts
+    printf("Enter location: ");
+    printf("\033[0m"); // Reset color
+
+    printf("\033[1;33m");
+    scanf("%49s", entry.location);
+    printf("\033[0m");
+
+    // Check if location already exists in the resident table (case-insensitive)
+    if (findLocation(entry.location) != -1)
+    {
+        printf("\033[1;31m"); // Red for error
+        printf("Location '%s' already exists.\n", entry.location);
+        printf("\033[0m"); // Reset color
+        return;
+    }
+
+    // Location doesn't exist, proceed with data input
+    printf("\033[1;34m"); // Blue for input prompts
+    printf("Enter rainfall (in mm): ");
+    printf("\033[0m"); // Reset color
+
+    printf("\033[1;33m");
+    scanf("%f", &entry.rainfall);
+    printf("\033[0m");
+
+    printf("\033[1;34m"); // Blue for input prompts
+    printf("Enter temperature (in degrees celsius): ");
+    printf("\033[0m"); // Reset color
+
+    printf("\033[1;33m");
+    scanf("%f", &entry.temperature);
+    printf("\033[0m");
+
+    int slot = insertStation(entry.location, roundToStored(entry.rainfall), roundToStored(entry.temperature));
+    if (slot == -1)
+    {
+        printf("\033[1;31m"); // Red for error
+        printf("Not enough memory to add '%s'.\n", entry.location);
+        printf("\033[0m"); // Reset color
+        return;
+    }
+
+    clearScreen();
+    printf("\033[1;32m"); // Green for success message
+    loadingDotsAnimation(2,"Saving");
+    //printf("\nPlease wait...\n");
+    printf("\033[0m"); // Reset color
+    //delay(2);
+    printf("\033[1;32m"); // Green for success message
+    printf("\n\nData Saved Successfully for %s.\n", entry.location);
+    printf("\033[0m"); // Reset color
+    delay(1);
+
+    // Append the new data to the log
+    if (!storeInsertedStation(slot))
+    {
+        printf("\033[1;31m"); // Red for error
+        printf("Error saving data.\n");
+        printf("\033[0m"); // Reset color
+    }
+}
+
+
+///delete data based on location
+void deleteData()
+{
+    char locationToDelete[50];
+    int foundIndex = -1;
+
+    // Get location to delete from user
+    printf("\033[1;34m"); // Blue for input prompts
+    printf("Enter the location to delete: ");
+    printf("\033[0m"); // Reset color
+
+    printf("\033[1;33m");
+    scanf("%49s", locationToDelete);
+    printf("\033[0m");
+
+    // Search for the location in the resident table
+    foundIndex = findLocation(locationToDelete);
+
+    if (foundIndex == -1)
+    {
+        printf("\033[1;31m"); // Red for error
+        printf("Location '%s' not found.\n", locationToDelete);
+        printf("\033[0m"); // Reset color
+        return;
+    }
+
+    clearScreen();
+    loadingDotsAnimation(2,"Deleting");
+    clearScreen();
+
+    printf("\033[1;32m"); // Green for success
+    printf("\nData successfully deleted for location: %s\n", locationToDelete);
+    printf("\033[0m"); // Reset color
+
+    // Persist the delete while the slot still describes the station
+    if (!storeDeletedStation(foundIndex))
+    {
+        printf("\033[1;31m"); // Red for error
+        printf("Error saving data.\n");
+        printf("\033[0m"); // Reset color
+    }
+
+    // Move the last entry into the freed slot so the delete doesn't shift the table
+    removeStation(foundIndex);
+}
+
+
+
+///////////////// END //////////////
+
+///////////// FOR UPDATE ENV DATA /////////////
+void updateData()
+{
+    int foundIndex = -1;
     char newLocation[50];
 
-    // Load existing data from file
-    EnvironmentalData existingData[MAX_DATA_ENTRIES];
-    int existingCount = loadDataFromFile(existingData);
+    // Get location input from user
+    printf("\033[1;34m"); // Blue color for prompt
+    printf("Enter the location name to update: ");
+    printf("\033[0m"); // Reset color
+
+    printf("\033[1;33m");
+    scanf("%49s", newLocation);
+    printf("\033[0m");
+
+    clearScreen();
+    loadingDotsAnimation(2, "Searching");
+    // Check if location exists in the resident table (case-insensitive)
+    foundIndex = findLocation(newLocation);
+
+    if (foundIndex != -1)
+    {
+        const char *location = stations.location[foundIndex];
+        float rainfall = stations.rainfall[foundIndex], temperature = stations.temperature[foundIndex];
+
+        // Update the existing data for the found location
+        clearScreen();
+        printf("\033[1;32m"); // Green for success
+        printf("Updating Data for %s.\n\n", location);
+        printf("\033[0m"); // Reset color
+        printf("\033[1;34m");
+        printf("Enter new rainfall (in mm): ");
+        printf("\033[0m");
+        printf("\033[1;33m");
+        scanf("%f", &rainfall);
+        printf("\033[1;0m");
+        printf("\033[1;34m");
+        printf("Enter new temperature (in degrees celsius): ");
+        printf("\033[0m");
+        printf("\033[1;33m");
+        scanf("%f", &temperature);
+        printf("\033[0m");
+
+        stations.rainfall[foundIndex] = roundToStored(rainfall);
+        stations.temperature[foundIndex] = roundToStored(temperature);
+
+        clearScreen();
+        printf("\033[1;32m"); // Green for success
+        loadingDotsAnimation(2,"Updating");
+        printf("\033[0m"); // Reset color
+
+        clearScreen();
+
+        printf("\033[1;32m"); // Green for success
+        printf("Data Updated Successfully for %s.\n", location);
+        printf("\033[0m"); // Reset color
+
+        // Log the update
+        if (!storeUpdatedStation(foundIndex))
+        {
+            printf("\033[1;31m"); // Red for error
+            printf("Error saving data.\n");
+            printf("\033[0m"); // Reset color
+            return;
+        }
+    }
+    else
+    {
+        clearScreen();
+        printf("\033[1;31m"); // Red for error
+        printf("Location '%s' not found in the data.\n", newLocation);
+        printf("\033[0m"); // Reset color
+    }
+}
+
+//////////////////////////// END ///////////////////////////
+
+////////////////// STATION MODEL PARAMETERS //////////////////////
+/*
+data_base/params.txt holds the coefficients of stations calibrated away from
+the global constants, one line per station:
+    <location> <alpha> <beta> <gamma> <factor> <threshold> [<24h> <72h> <7d weight>]
+They are kept column-wise (one column per coefficient) with a name index.
+Stations without a row, or whose row equals the defaults, stay on the batch
+kernels' constant coefficients; only the calibrated rows are recomputed.
+Every station slot keeps its row in stations.parameters, and the batch paths
+walk the rows to find the slots to recompute rather than testing every slot.
+*/
+
+const double defaultParameters[MODEL_PARAMETERS] = {ALPHA, BETA, GAMMA, CONVENTION_FACTOR, THRESHOLD_WATER_LEVEL,
+                                                    RAIN_24H_WEIGHT, RAIN_72H_WEIGHT, RAIN_7D_WEIGHT};
+
+// Function to rebuild the parameter index, at most half full
+int rebuildParameterIndex()
+{
+    unsigned int capacity = 16;
+    while (capacity < (unsigned int)stationParameters.count * 2)
+    {
+        capacity *= 2;
+    }
+    int *index = calloc(capacity, sizeof(int));
+    if (index == NULL)
+    {
+        return 0;
+    }
+    for (int row = 0; row < stationParameters.count; row++)
+    {
+        unsigned int bucket = hashLocation(stationParameters.location[row]) & (capacity - 1);
+        while (index[bucket] != 0)
+        {
+            bucket = (bucket + 1) & (capacity - 1);
+        }
+        index[bucket] = row + 1;
+    }
+    free(parameterIndex);
+    parameterIndex = index;
+    parameterIndexCapacity = capacity;
+    return 1;
+}
+
+// Function to add a parameter row to the index, growing it to stay at most half full
+int indexParameterRow(int row)
+{
+    if ((unsigned int)stationParameters.count * 2 > parameterIndexCapacity)
+    {
+        return rebuildParameterIndex();
+    }
+    unsigned int bucket = hashLocation(stationParameters.location[row]) & (parameterIndexCapacity - 1);
+    while (parameterIndex[bucket] != 0)
+    {
+        bucket = (bucket + 1) & (parameterIndexCapacity - 1);
+    }
+    parameterIndex[bucket] = row + 1;
+    return 1;
+}
+
+// Function to set a station's coefficients; coefficients equal to the defaults remove its row
+int setStationParameters(const char *location, const double values[MODEL_PARAMETERS])
+{
+    int row = findStationParameters(location);
+
+    if (memcmp(values, defaultParameters, sizeof(defaultParameters)) == 0)
+    {
+        if (row != -1)
+        {
+            // move the last row into the freed one
+            int last = --stationParameters.count, slot = findLocation(location);
+            if (slot != -1)
+            {
+                stations.parameters[slot] = -1;
+            }
+            for (int p = 0; p < MODEL_PARAMETERS; p++)
+            {
+                stationParameters.column[p][row] = stationParameters.column[p][last];
+            }
+            stationParameters.location[row] = stationParameters.location[last];
+            rebuildParameterIndex();
+            if (row != last && (slot = findLocation(stationParameters.location[row])) != -1)
+            {
+                stations.parameters[slot] = row;
+            }
+        }
+        return 1;
+    }
+
+    if (row == -1)
+    {
+        if (stationParameters.count == stationParameters.capacity)
+        {
+            int capacity = stationParameters.capacity ? stationParameters.capacity * 2 : 64;
+            for (int p = 0; p < MODEL_PARAMETERS; p++)
+            {
+                if (!growColumn((void **)&stationParameters.column[p], sizeof(double), capacity))
+                {
+                    return 0;
+                }
+            }
+            if (!growColumn((void **)&stationParameters.location, sizeof(char *), capacity))
+            {
+                return 0;
+            }
+            stationParameters.capacity = capacity;
+        }
+        char *name = poolLocation(location);
+        if (name == NULL)
+        {
+            return 0;
+        }
+        row = stationParameters.count++;
+        stationParameters.location[row] = name;
+        if (!indexParameterRow(row))
+        {
+            stationParameters.count--;
+            return 0;
+        }
+        int slot = findLocation(location);
+        if (slot != -1)
+        {
+            stations.parameters[slot] = row;
+        }
+    }
+    for (int p = 0; p < MODEL_PARAMETERS; p++)
+    {
+        stationParameters.column[p][row] = values[p];
+    }
+    return 1;
+}
+
+// Function to get the coefficients a station predicts with
+void getStationParameters(const char *location, double values[MODEL_PARAMETERS])
+{
+    int row = findStationParameters(location);
+    for (int p = 0; p < MODEL_PARAMETERS; p++)
+    {
+        values[p] = row < 0 ? defaultParameters[p] : stationParameters.column[p][row];
+    }
+}
+
+// Function to parse a text field as a double, exactly as written
+int parseDoubleField(const TextField *field, double *value)
+{
+    char text[64];
+    char *end;
+    if (!copyField(field, text, sizeof(text)))
+    {
+        return 0;
+    }
+    *value = strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
+// Function to load params.txt into the parameter columns (a missing file means every station is on the defaults)
+int loadStationParameters()
+{
+    LineReader reader;
+    if (!openLineReader(&reader, parameter_file))
+    {
+        return 0;
+    }
+
+    const char *line;
+    size_t length;
+    int loaded = 0;
+    while (nextLine(&reader, &line, &length))
+    {
+        TextField fields[MODEL_PARAMETERS + 1];
+        char location[MAX_LOCATION_LENGTH];
+        double values[MODEL_PARAMETERS];
+        int count = splitFields(line, length, fields, MODEL_PARAMETERS + 1);
+        if (count != PARAM_RAIN_24H + 1 && count != MODEL_PARAMETERS + 1)
+        {
+            continue; // malformed line
+        }
+        memcpy(values, defaultParameters, sizeof(values)); // the accumulation weights are optional
+        int ok = copyField(&fields[0], location, sizeof(location));
+        for (int p = 0; p < count - 1 && ok; p++)
+        {
+            ok = parseDoubleField(&fields[p + 1], &values[p]);
+        }
+        if (ok && setStationParameters(location, values))
+        {
+            loaded++;
+        }
+    }
+    closeLineReader(&reader);
+    return loaded;
+}
+
+// Function to write the parameter columns back to params.txt
+int saveStationParameters()
+{
+    char temp[256];
+    snprintf(temp, sizeof(temp), "%s.tmp", parameter_file);
+
+    FILE *file = fopen(temp, "w");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    int ok = 1;
+    for (int row = 0; row < stationParameters.count && ok; row++)
+    {
+        ok = fprintf(file, "%s", stationParameters.location[row]) > 0;
+        for (int p = 0; p < MODEL_PARAMETERS && ok; p++)
+        {
+            ok = fprintf(file, " %.17g", stationParameters.column[p][row]) > 0; // round-trips exactly
+        }
+        ok = ok && fputc('\n', file) != EOF;
+    }
+    syncFile(file);
+    fclose(file);
+    if (!ok || !replaceFile(temp, parameter_file))
+    {
+        remove(temp);
+        return 0;
+    }
+    return 1;
+}
+
+///////////////////////// END /////////////////////////////
+
+////////////////// RATING CURVES //////////////////////
+/*
+data_base/ratings.txt replaces CONVENTION_FACTOR with a stage-discharge
+(rating) curve at the stations that have one, one per line:
+    <location> power <a> <b> <h0> [<highest units>]
+    <location> table <units> <stage> <units> <stage> ...
+The power form is the usual gauging fit Q = a * (h - h0)^b, with the model's
+weighted sum taken as the flow Q; it is inverted to h = h0 + (Q / a)^(1/b)
+over [0, highest units] (RATING_MAX_UNITS unless given). A table lists the
+stage at increasing units and is interpolated linearly between its points.
+Either way the curve is compiled to RATING_POINTS evenly spaced knots, so a
+conversion is one multiply to the knot, two loads and a linear step:
+    x = (units - low) * scale, i = clamp(floor(x), 0, RATING_POINTS - 2)
+    stage = knot[i] + (x - i) * (knot[i + 1] - knot[i])
+with no branch on the segment, which the rated batch kernel gathers eight
+stations at a time. Beyond its ends a curve goes on along its end segments.
+Stages have to rise with the units so calibration can invert the curve.
+Every station slot keeps its curve in stations.curve (set as curves and
+stations are added), so the batch paths never look a curve up by name.
+*/
+
+// Function to rebuild the rating index, at most half full
+int rebuildRatingIndex()
+{
+    unsigned int capacity = 16;
+    while (capacity < (unsigned int)ratingCurves.count * 2)
+    {
+        capacity *= 2;
+    }
+    int *index = calloc(capacity, sizeof(int));
+    if (index == NULL)
+    {
+        return 0;
+    }
+    for (int curve = 0; curve < ratingCurves.count; curve++)
+    {
+        unsigned int bucket = hashLocation(ratingCurves.location[curve]) & (capacity - 1);
+        while (index[bucket] != 0)
+        {
+            bucket = (bucket + 1) & (capacity - 1);
+        }
+        index[bucket] = curve + 1;
+    }
+    free(ratingCurves.index);
+    ratingCurves.index = index;
+    ratingCurves.indexCapacity = capacity;
+    return 1;
+}
+
+// Function to add a curve to the rating index, growing it to stay at most half full
+int indexRatingCurve(int curve)
+{
+    if ((unsigned int)ratingCurves.count * 2 > ratingCurves.indexCapacity)
+    {
+        return rebuildRatingIndex();
+    }
+    unsigned int bucket = hashLocation(ratingCurves.location[curve]) & (ratingCurves.indexCapacity - 1);
+    while (ratingCurves.index[bucket] != 0)
+    {
+        bucket = (bucket + 1) & (ratingCurves.indexCapacity - 1);
+    }
+    ratingCurves.index[bucket] = curve + 1;
+    return 1;
+}
+
+// Function to convert model units to a stage in meters through a compiled curve
+float ratingStage(int curve, float units)
+{
+    const float *knots = ratingCurves.knots + (size_t)curve * RATING_POINTS;
+    float x = (units - ratingCurves.low[curve]) * ratingCurves.scale[curve];
+    float cell = fminf(fmaxf(x, 0.0f), RATING_POINTS - 2);
+    int i = (int)cell;
+    return knots[i] + (x - i) * (knots[i + 1] - knots[i]);
+}
+
+// Function to get a curve's meters per model unit between two unit values (its segment's slope where they meet)
+float ratingSlope(int curve, float from, float to)
+{
+    if (to != from)
+    {
+        return (ratingStage(curve, to) - ratingStage(curve, from)) / (to - from);
+    }
+    const float *knots = ratingCurves.knots + (size_t)curve * RATING_POINTS;
+    float x = (from - ratingCurves.low[curve]) * ratingCurves.scale[curve];
+    int i = (int)fminf(fmaxf(x, 0.0f), RATING_POINTS - 2);
+    return (knots[i + 1] - knots[i]) * ratingCurves.scale[curve];
+}
+
+// Function to convert a stage back to model units (calibration fits the units a gauge reading stands for)
+double ratingUnits(int curve, double stage)
+{
+    const float *knots = ratingCurves.knots + (size_t)curve * RATING_POINTS;
+    int low = 0, high = RATING_POINTS - 2; // last knot at or below the stage, on the end segments outside
+    while (low < high)
+    {
+        int middle = (low + high + 1) / 2;
+        if (knots[middle] <= stage)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+    double rise = knots[low + 1] - knots[low];
+    double x = rise > 0 ? low + (stage - knots[low]) / rise : low;
+    return ratingCurves.low[curve] + x / ratingCurves.scale[curve];
+}
+
+// Function to set the rating curve of a station from points of increasing units; stages must not fall.
+// Returns 0 when the points can't make a curve or out of memory.
+int setRatingCurve(const char *location, const double *units, const double *stages, int points)
+{
+    if (points < 2)
+    {
+        return 0;
+    }
+    for (int j = 1; j < points; j++)
+    {
+        if (!(units[j] > units[j - 1]) || !(stages[j] >= stages[j - 1]))
+        {
+            return 0;
+        }
+    }
+    if (!(stages[points - 1] > stages[0]))
+    {
+        return 0; // a flat curve can't be inverted
+    }
+
+    int curve = findRatingCurve(location);
+    if (curve == -1)
+    {
+        if (ratingCurves.count == ratingCurves.capacity)
+        {
+            int capacity = ratingCurves.capacity ? ratingCurves.capacity * 2 : 64;
+            if (!growColumn((void **)&ratingCurves.knots, RATING_POINTS * sizeof(float), capacity) ||
+                !growColumn((void **)&ratingCurves.low, sizeof(float), capacity) ||
+                !growColumn((void **)&ratingCurves.scale, sizeof(float), capacity) ||
+                !growColumn((void **)&ratingCurves.location, sizeof(char *), capacity))
+            {
+                return 0;
+            }
+            ratingCurves.capacity = capacity;
+        }
+        char *name = poolLocation(location);
+        if (name == NULL)
+        {
+            return 0;
+        }
+        curve = ratingCurves.count++;
+        ratingCurves.location[curve] = name;
+        if (!indexRatingCurve(curve))
+        {
+            ratingCurves.count--;
+            return 0;
+        }
+        int slot = findLocation(location);
+        if (slot != -1)
+        {
+            stations.curve[slot] = curve;
+        }
+    }
+
+    // knot j sits where ratingStage puts it: units = low + j / scale, with both rounded to float
+    float low = (float)units[0];
+    float scale = (float)((RATING_POINTS - 1) / (units[points - 1] - units[0]));
+    float *knots = ratingCurves.knots + (size_t)curve * RATING_POINTS;
+    for (int j = 0, segment = 0; j < RATING_POINTS; j++)
+    {
+        double at = low + j / (double)scale;
+        while (segment < points - 2 && at > units[segment + 1])
+        {
+            segment++;
+        }
+        double share = (at - units[segment]) / (units[segment + 1] - units[segment]);
+        knots[j] = (float)(stages[segment] + share * (stages[segment + 1] - stages[segment]));
+    }
+    ratingCurves.low[curve] = low;
+    ratingCurves.scale[curve] = scale;
+    return 1;
+}
+
+// Function to set a station's rating curve from a power-law fit Q = a * (h - h0)^b over [0, high] units
+int setPowerRatingCurve(const char *location, double a, double b, double h0, double high)
+{
+    if (!(a > 0) || !(b > 0) || !(high > 0))
+    {
+        return 0;
+    }
+    double units[RATING_POINTS], stages[RATING_POINTS];
+    for (int j = 0; j < RATING_POINTS; j++)
+    {
+        units[j] = high * j / (RATING_POINTS - 1);
+        stages[j] = h0 + pow(units[j] / a, 1 / b);
+    }
+    return setRatingCurve(location, units, stages, RATING_POINTS);
+}
+
+// Function to load the rating curves from ratings.txt, returns how many were loaded
+int loadRatingCurves()
+{
+    LineReader reader;
+    if (!openLineReader(&reader, rating_file))
+    {
+        return 0;
+    }
+
+    TextField fields[2 * RATING_TABLE_PAIRS + 3];
+    const char *line;
+    size_t length;
+    int loaded = 0;
+    while (nextLine(&reader, &line, &length))
+    {
+        char location[MAX_LOCATION_LENGTH], form[8];
+        double values[2 * RATING_TABLE_PAIRS];
+        int count = splitFields(line, length, fields, 2 * RATING_TABLE_PAIRS + 2);
+        if (count < 5 || count > 2 * RATING_TABLE_PAIRS + 2 ||
+            !copyField(&fields[0], location, sizeof(location)) || !copyField(&fields[1], form, sizeof(form)))
+        {
+            continue; // malformed line
+        }
+        int ok = 1;
+        for (int j = 0; j < count - 2 && ok; j++)
+        {
+            ok = parseDoubleField(&fields[j + 2], &values[j]);
+        }
+        if (ok && strcmp(form, "power") == 0 && (count == 5 || count == 6))
+        {
+            ok = setPowerRatingCurve(location, values[0], values[1], values[2], count == 6 ? values[3] : RATING_MAX_UNITS);
+        }
+        else if (ok && strcmp(form, "table") == 0 && count % 2 == 0)
+        {
+            double units[RATING_TABLE_PAIRS], stages[RATING_TABLE_PAIRS];
+            for (int j = 0; j < (count - 2) / 2; j++)
+            {
+                units[j] = values[2 * j];
+                stages[j] = values[2 * j + 1];
+            }
+            ok = setRatingCurve(location, units, stages, (count - 2) / 2);
+        }
+        else
+        {
+            ok = 0;
+        }
+        loaded += ok;
+    }
+    closeLineReader(&reader);
+    return loaded;
+}
+
+///////////////////////// END /////////////////////////////
+
+////////////////// UNIT HYDROGRAPH CONVOLUTION //////////////////////
+/*
+data_base/hydrographs.txt gives stations a unit hydrograph, one per line:
+    <location> <ordinate 0> <ordinate 1> ... (one per hour, usually summing to 1)
+For such a station ALPHA multiplies the hourly rainfall history convolved with
+the hydrograph instead of the latest reading, so rain reaches the river over
+the following hours as the catchment delivers it:
+    runoff(h) = sum over j of ordinate[j] * rainfall(hour h - j)
+Lead-time forecasts take the same convolution further ahead with no new rain,
+and calibration fits ALPHA against it.
+
+Convolutions are computed in "valid" form over a series that starts
+length - 1 hours before the first output. Short kernels use a direct
+convolution (AVX2, 8 outputs per step, when the CPU has it); long kernels over
+long series use overlap-save FFT blocks, two real blocks per complex
+transform. The direct kernels are bit-identical to each other; the FFT path
+agrees with them to float rounding.
+*/
+
+// Function to convolve directly: out[i] = sum over j of kernel[length - 1 - j] * signal[i + j], i < outputs
+void convolveDirectScalar(const float *signal, const float *kernel, int length, float *out, int outputs)
+{
+    for (int i = 0; i < outputs; i++)
+    {
+        float sum = 0;
+        for (int j = 0; j < length; j++)
+        {
+            sum += kernel[length - 1 - j] * signal[i + j];
+        }
+        out[i] = sum;
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+// AVX2 direct convolution: 8 outputs per step, summed in the scalar order
+__attribute__((target("avx2"))) void convolveDirectAvx2(const float *signal, const float *kernel, int length, float *out, int outputs)
+{
+    int i = 0;
+    for (; i + 8 <= outputs; i += 8)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        for (int j = 0; j < length; j++)
+        {
+            __m256 tap = _mm256_set1_ps(kernel[length - 1 - j]);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(tap, _mm256_loadu_ps(signal + i + j)));
+        }
+        _mm256_storeu_ps(out + i, sum);
+    }
+    convolveDirectScalar(signal + i, kernel, length, out + i, outputs - i);
+}
+#endif
+
+// direct convolution picked for this CPU on first use, once even when pool tasks get there together
+void (*convolveDirectKernel)(const float *, const float *, int, float *, int) = NULL;
+OnceFlag convolveDirectSelected = ONCE_INIT;
+
+// Function to pick the direct convolution kernel for this CPU
+void selectConvolveDirectKernel()
+{
+    convolveDirectKernel = convolveDirectScalar;
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        convolveDirectKernel = convolveDirectAvx2;
+    }
+#endif
+}
+
+// Function to convolve directly with the best kernel
+void convolveDirect(const float *signal, const float *kernel, int length, float *out, int outputs)
+{
+    runOnce(&convolveDirectSelected, selectConvolveDirectKernel);
+    convolveDirectKernel(signal, kernel, length, out, outputs);
+}
+
+// Function to run an in-place radix-2 FFT of size n (a power of 2) with the twiddles
+// cosTable[k] = cos(2 pi k / n), sinTable[k] = sin(2 pi k / n), k < n / 2; the inverse is unscaled
+void fftRadix2(double *re, double *im, int n, const double *cosTable, const double *sinTable, int inverse)
+{
+    for (int i = 1, j = 0; i < n; i++)
+    {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j |= bit;
+        if (i < j)
+        {
+            double swap = re[i];
+            re[i] = re[j];
+            re[j] = swap;
+            swap = im[i];
+            im[i] = im[j];
+            im[j] = swap;
+        }
+    }
+
+    for (int size = 2; size <= n; size *= 2)
+    {
+        int half = size / 2, step = n / size;
+        for (int start = 0; start < n; start += size)
+        {
+            for (int k = 0; k < half; k++)
+            {
+                double wr = cosTable[k * step], wi = inverse ? sinTable[k * step] : -sinTable[k * step];
+                int a = start + k, b = a + half;
+                double tr = re[b] * wr - im[b] * wi;
+                double ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+// Function to convolve through overlap-save FFT blocks, same result as convolveDirect up to rounding.
+// Returns 0 when out of memory.
+int convolveFft(const float *signal, const float *kernel, int length, float *out, int outputs)
+{
+    // blocks of about 4 kernel lengths, smaller when every output fits in one
+    int n = 2;
+    while (n < 4 * length && n < length + outputs - 1)
+    {
+        n *= 2;
+    }
+    int step = n - length + 1; // outputs per block
+
+    double *buffer = malloc((size_t)n * 6 * sizeof(double));
+    if (buffer == NULL)
+    {
+        return 0;
+    }
+    double *cosTable = buffer, *sinTable = buffer + n / 2;
+    double *kernelRe = buffer + n, *kernelIm = buffer + 2 * n, *re = buffer + 3 * n, *im = buffer + 4 * n;
+    for (int k = 0; k < n / 2; k++)
+    {
+        cosTable[k] = cos(2 * 3.14159265358979323846 * k / n);
+        sinTable[k] = sin(2 * 3.14159265358979323846 * k / n);
+    }
+
+    // spectrum of the kernel, scaled for the unscaled inverse
+    for (int k = 0; k < n; k++)
+    {
+        kernelRe[k] = k < length ? kernel[k] / (double)n : 0;
+        kernelIm[k] = 0;
+    }
+    fftRadix2(kernelRe, kernelIm, n, cosTable, sinTable, 0);
+
+    // two blocks per transform: one in the real part, the next in the imaginary part
+    for (int first = 0; first < outputs; first += 2 * step)
+    {
+        for (int k = 0; k < n; k++)
+        {
+            int a = first + k, b = first + step + k; // signal holds outputs + length - 1 values
+            re[k] = a < outputs + length - 1 ? signal[a] : 0;
+            im[k] = b < outputs + length - 1 ? signal[b] : 0;
+        }
+        fftRadix2(re, im, n, cosTable, sinTable, 0);
+        for (int k = 0; k < n; k++)
+        {
+            double r = re[k] * kernelRe[k] - im[k] * kernelIm[k];
+            im[k] = re[k] * kernelIm[k] + im[k] * kernelRe[k];
+            re[k] = r;
+        }
+        fftRadix2(re, im, n, cosTable, sinTable, 1);
+
+        // the first length - 1 values of each block wrapped around, the rest are valid outputs
+        for (int k = 0; k < step; k++)
+        {
+            if (first + k < outputs)
+            {
+                out[first + k] = (float)re[length - 1 + k];
+            }
+            if (first + step + k < outputs)
+            {
+                out[first + step + k] = (float)im[length - 1 + k];
+            }
+        }
+    }
+    free(buffer);
+    return 1;
+}
+
+// Function to tell whether a convolution is cheaper through the FFT: long kernels over at least as many outputs
+int convolutionUsesFft(int length, int outputs)
+{
+    runOnce(&convolveDirectSelected, selectConvolveDirectKernel);
+    int taps = convolveDirectKernel == convolveDirectScalar ? CONVOLUTION_FFT_TAPS_SCALAR : CONVOLUTION_FFT_TAPS;
+    return length >= taps && outputs >= length;
+}
+
+// Function to convolve a series with a kernel: out[i] = sum over j of kernel[j] * signal[i + length - 1 - j]
+// for i < outputs (signal holds outputs + length - 1 values); picks the direct or the FFT path
+void convolveSeries(const float *signal, const float *kernel, int length, float *out, int outputs)
+{
+    if (convolutionUsesFft(length, outputs) && convolveFft(signal, kernel, length, out, outputs))
+    {
+        return;
+    }
+    convolveDirect(signal, kernel, length, out, outputs);
+}
+
+// hourly rainfall of a station being binned from its history
+typedef struct
+{
+    float *series;
+    long long firstHour;
+    int hours;
+} HourlyRainfall;
+
+// Function to add an observation's rainfall to its hour (a scanHistory visitor)
+void binHourlyRainfall(const Observation *point, void *arg)
+{
+    HourlyRainfall *binned = arg;
+    long long hour = point->time / 3600 - binned->firstHour;
+    if (hour >= 0 && hour < binned->hours)
+    {
+        binned->series[hour] += point->rainfall;
+    }
+}
+
+// Function to fill series with the station's rainfall per hour for hours [firstHour, firstHour + hours)
+void hourlyRainfall(const char *location, long long firstHour, int hours, float *series)
+{
+    HourlyRainfall binned = {series, firstHour, hours};
+    memset(series, 0, hours * sizeof(float));
+    scanHistory(location, firstHour * 3600, (firstHour + hours) * 3600 - 1, binHourlyRainfall, &binned);
+}
+
+// Function to get the unit hydrograph of a station, NULL when its rainfall acts at once
+const HistorySeries *stationHydrograph(const char *location)
+{
+    if (hydrographCount == 0)
+    {
+        return NULL;
+    }
+    const HistorySeries *series = findHistorySeries(location, 0);
+    return series != NULL && series->hydrograph != NULL ? series : NULL;
+}
+
+// Function to compute a station's runoff for hours [firstHour, firstHour + hours); hours after the
+// newest observation get no new rain. Returns 0 when out of memory.
+int hydrographRunoff(const HistorySeries *series, long long firstHour, int hours, float *runoff)
+{
+    int length = series->hydrographLength;
+    float *signal = malloc((size_t)(length - 1 + hours) * sizeof(float));
+    if (signal == NULL)
+    {
+        return 0;
+    }
+    hourlyRainfall(series->location, firstHour - length + 1, length - 1 + hours, signal);
+    convolveSeries(signal, series->hydrograph, length, runoff, hours);
+    free(signal);
+    return 1;
+}
+
+// Function to set the unit hydrograph of a station (length 0 removes it)
+int setStationHydrograph(const char *location, const float *ordinates, int length)
+{
+    HistorySeries *series = findHistorySeries(location, length > 0);
+    if (series == NULL)
+    {
+        return length == 0;
+    }
+    float *hydrograph = NULL;
+    if (length > 0)
+    {
+        hydrograph = malloc(length * sizeof(float));
+        if (hydrograph == NULL)
+        {
+            return 0;
+        }
+        memcpy(hydrograph, ordinates, length * sizeof(float));
+    }
+    hydrographCount += (hydrograph != NULL) - (series->hydrograph != NULL);
+    free(series->hydrograph);
+    series->hydrograph = hydrograph;
+    series->hydrographLength = length;
+    return 1;
+}
+
+// Function to load the unit hydrographs from hydrographs.txt, returns how many were loaded
+int loadHydrographs()
+{
+    LineReader reader;
+    if (!openLineReader(&reader, hydrograph_file))
+    {
+        return 0;
+    }
+
+    TextField *fields = malloc((MAX_HYDROGRAPH_LENGTH + 1) * sizeof(TextField));
+    float *ordinates = malloc(MAX_HYDROGRAPH_LENGTH * sizeof(float));
+    const char *line;
+    size_t length;
+    int loaded = 0;
+    while (fields != NULL && ordinates != NULL && nextLine(&reader, &line, &length))
+    {
+        char location[MAX_LOCATION_LENGTH];
+        int count = splitFields(line, length, fields, MAX_HYDROGRAPH_LENGTH + 1);
+        int ok = count >= 2 && count <= MAX_HYDROGRAPH_LENGTH + 1 && copyField(&fields[0], location, sizeof(location));
+        for (int j = 0; j < count - 1 && ok; j++)
+        {
+            double value = 0;
+            ok = parseDoubleField(&fields[j + 1], &value);
+            ordinates[j] = (float)value;
+        }
+        if (ok && setStationHydrograph(location, ordinates, count - 1))
+        {
+            loaded++;
+        }
+    }
+    free(fields);
+    free(ordinates);
+    closeLineReader(&reader);
+    return loaded;
+}
+
+///////////////////////// END /////////////////////////////
+
+////////////////// ENSEMBLE FORECAST //////////////////////
+/*
+An ensemble forecast runs every station's model for ensembleSettings.members
+members, each on rainfall and temperature perturbed as the settings say, and
+reports the 10th, 50th and 90th percentile water level and the share of
+members above the station's danger level.
+
+The random numbers come from Philox4x32-10, a counter-based generator: the
+draws of a member are a pure function of (seed, station name, member), so
+there is no generator state to share or hand out per thread and the results
+are the same for a given seed on any number of threads, in any station order.
+*/
+
+// Function to run Philox4x32-10 on the counters (first + lane, 0, stream) of ENSEMBLE_LANES members at once,
+// four random 32-bit words per member; the lanes are independent, so their rounds overlap
+void philox4x32(unsigned int first, unsigned long long stream, unsigned long long seed, unsigned int out[4][ENSEMBLE_LANES])
+{
+    unsigned int c0[ENSEMBLE_LANES], c1[ENSEMBLE_LANES], c2[ENSEMBLE_LANES], c3[ENSEMBLE_LANES];
+    for (int lane = 0; lane < ENSEMBLE_LANES; lane++)
+    {
+        c0[lane] = first + lane;
+        c1[lane] = 0;
+        c2[lane] = (unsigned int)stream;
+        c3[lane] = (unsigned int)(stream >> 32);
+    }
+
+    unsigned int k0 = (unsigned int)seed, k1 = (unsigned int)(seed >> 32);
+    for (int round = 0; round < 10; round++)
+    {
+        for (int lane = 0; lane < ENSEMBLE_LANES; lane++)
+        {
+            unsigned long long product0 = (unsigned long long)0xD2511F53u * c0[lane];
+            unsigned long long product1 = (unsigned long long)0xCD9E8D57u * c2[lane];
+            c0[lane] = (unsigned int)(product1 >> 32) ^ c1[lane] ^ k0;
+            c1[lane] = (unsigned int)product1;
+            c2[lane] = (unsigned int)(product0 >> 32) ^ c3[lane] ^ k1;
+            c3[lane] = (unsigned int)product0;
+        }
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    memcpy(out[0], c0, sizeof(c0));
+    memcpy(out[1], c1, sizeof(c1));
+    memcpy(out[2], c2, sizeof(c2));
+    memcpy(out[3], c3, sizeof(c3));
+}
+
+// Function to turn a random word into a uniform float in (0, 1)
+float uniformFromBits(unsigned int bits)
+{
+    return ((bits >> 8) + 0.5f) * (1.0f / 16777216.0f); // the top 24 bits, all a float holds
+}
+
+// Function to perturb an input value with one of the ensemble distributions
+float perturbValue(float value, int distribution, float spread, float normal, float uniform)
+{
+    switch (distribution)
+    {
+    case ENSEMBLE_NORMAL:
+        return value + spread * normal;
+    case ENSEMBLE_LOGNORMAL:
+        return value * expf(spread * normal - spread * spread / 2);
+    case ENSEMBLE_UNIFORM:
+        return value + spread * (2 * uniform - 1);
+    default:
+        return value;
+    }
+}
+
+// Function to move the k-th smallest of values[first, last) to position k (quickselect)
+void selectRank(float *values, int first, int last, int k)
+{
+    while (last - first > 1)
+    {
+        float pivot = values[first + (last - first) / 2];
+        int i = first, j = last - 1;
+        while (i <= j)
+        {
+            while (values[i] < pivot)
+            {
+                i++;
+            }
+            while (values[j] > pivot)
+            {
+                j--;
+            }
+            if (i <= j)
+            {
+                float swap = values[i];
+                values[i++] = values[j];
+                values[j--] = swap;
+            }
+        }
+        // now values[first, j] <= pivot <= values[i, last), anything between equals the pivot
+        if (k <= j)
+        {
+            last = j + 1;
+        }
+        else if (k >= i)
+        {
+            first = i;
+        }
+        else
+        {
+            return;
+        }
+    }
+}
+
+// Function to run the ensemble of one station with its parameter row and rating curve (as for
+// station_water_level); members is scratch room for ensembleSettings.members levels
+void ensembleStation(int row, int curve, const char *location, float rainfall, float temperature, long long now, float *members, EnsembleResult *result)
+{
+    const EnsembleSettings *settings = &ensembleSettings;
+    double parameters[MODEL_PARAMETERS];
+    for (int p = 0; p < MODEL_PARAMETERS; p++)
+    {
+        parameters[p] = row < 0 ? defaultParameters[p] : stationParameters.column[p][row];
+    }
+
+    double accumulated = 0;
+    if (parameters[PARAM_RAIN_24H] != 0 || parameters[PARAM_RAIN_72H] != 0 || parameters[PARAM_RAIN_7D] != 0)
+    {
+        float sums[RAIN_WINDOWS];
+        rollingRainfall(location, now, sums);
+        accumulated = parameters[PARAM_RAIN_24H] * sums[0] + parameters[PARAM_RAIN_72H] * sums[1] + parameters[PARAM_RAIN_7D] * sums[2];
+    }
+    const HistorySeries *delayed = stationHydrograph(location);
+    float runoff;
+    if (delayed != NULL && hydrographRunoff(delayed, now / 3600, 1, &runoff))
+    {
+        rainfall = runoff; // members perturb the rain arriving now
+    }
+
+    // the station's stream of the generator, by name so it doesn't depend on the station's slot
+    unsigned long long key = 14695981039346656037ull;
+    for (const char *c = location; *c != '\0'; c++)
+    {
+        key ^= (unsigned char)tolower((unsigned char)*c);
+        key *= 1099511628211ull;
+    }
+
+    int above = 0;
+    for (int first = 0; first < settings->members; first += ENSEMBLE_LANES)
+    {
+        unsigned int bits[4][ENSEMBLE_LANES];
+        philox4x32(first, key, settings->seed, bits);
+
+        int lanes = settings->members - first < ENSEMBLE_LANES ? settings->members - first : ENSEMBLE_LANES;
+        for (int lane = 0; lane < lanes; lane++)
+        {
+            // Box-Muller: two independent normals from two uniforms
+            float radius = sqrtf(-2 * logf(uniformFromBits(bits[0][lane])));
+            float angle = 6.2831853f * uniformFromBits(bits[1][lane]);
+            float r = perturbValue(rainfall, settings->rainDistribution, settings->rainSpread, radius * cosf(angle), uniformFromBits(bits[2][lane]));
+            float t = perturbValue(temperature, settings->temperatureDistribution, settings->temperatureSpread, radius * sinf(angle), uniformFromBits(bits[3][lane]));
+            if (r < 0)
+            {
+                r = 0; // no negative rainfall
+            }
+
+            // same arithmetic as station_water_level
+            float water_level = (parameters[PARAM_ALPHA] * r) + (parameters[PARAM_BETA] * t) + parameters[PARAM_GAMMA];
+            float level = curve >= 0 ? ratingStage(curve, water_level + (float)accumulated)
+                                     : (float)(water_level * parameters[PARAM_FACTOR]) + (float)(accumulated * parameters[PARAM_FACTOR]);
+            members[first + lane] = level;
+            above += level > parameters[PARAM_THRESHOLD];
+        }
+    }
+
+    // nearest-rank percentiles; P10 and P90 are searched on either side of P50 only
+    int n = settings->members;
+    int k10 = (10 * n + 99) / 100 - 1, k50 = (50 * n + 99) / 100 - 1, k90 = (90 * n + 99) / 100 - 1;
+    selectRank(members, 0, n, k50);
+    selectRank(members, 0, k50, k10);
+    selectRank(members, k50 + 1, n, k90);
+    result->p10 = members[k10];
+    result->p50 = members[k50];
+    result->p90 = members[k90];
+    result->exceedance = (float)above / n;
+}
+
+// ensemble of stations [0, count), split into blocks of ENSEMBLE_BLOCK for the thread pool
+typedef struct
+{
+    EnsembleResult *results;
+    long long now;
+} EnsembleJob;
+
+// Function to run the ensembles of one block of stations (a thread pool task)
+void ensembleBlockTask(int task, void *arg)
+{
+    EnsembleJob *job = arg;
+    float members[ENSEMBLE_MAX_MEMBERS];
+    int first = task * ENSEMBLE_BLOCK;
+    int last = first + ENSEMBLE_BLOCK < count ? first + ENSEMBLE_BLOCK : count;
+
+    for (int i = first; i < last; i++)
+    {
+        ensembleStation(stations.parameters[i], stations.curve[i], stations.location[i], stations.rainfall[i], stations.temperature[i], job->now, members, &job->results[i]);
+    }
+}
+
+// Function to run the ensemble of every station; returns results by slot (free them), NULL on error
+EnsembleResult *runEnsemble()
+{
+    EnsembleJob job = {malloc((count > 0 ? count : 1) * sizeof(EnsembleResult)), (long long)time(NULL)};
+    if (job.results != NULL)
+    {
+        runParallel((count + ENSEMBLE_BLOCK - 1) / ENSEMBLE_BLOCK, ensembleBlockTask, &job);
+    }
+    return job.results;
+}
+
+// Function to tell whether ensemble settings can be used
+int validEnsembleSettings(const EnsembleSettings *settings)
+{
+    return settings->members >= 1 && settings->members <= ENSEMBLE_MAX_MEMBERS &&
+           settings->rainDistribution >= 0 && settings->rainDistribution < ENSEMBLE_DISTRIBUTIONS &&
+           settings->temperatureDistribution >= 0 && settings->temperatureDistribution < ENSEMBLE_DISTRIBUTIONS &&
+           settings->rainSpread >= 0 && settings->temperatureSpread >= 0;
+}
+
+// Function to load the ensemble settings from ensemble.txt, the defaults stay if it is missing or malformed
+int loadEnsembleSettings()
+{
+    FILE *file = fopen(ensemble_file, "r");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    EnsembleSettings settings;
+    int ok = fscanf(file, "%d %llu %d %lf %d %lf", &settings.members, &settings.seed, &settings.rainDistribution,
+                    &settings.rainSpread, &settings.temperatureDistribution, &settings.temperatureSpread) == 6 &&
+             validEnsembleSettings(&settings);
+    fclose(file);
+    if (ok)
+    {
+        ensembleSettings = settings;
+    }
+    return ok;
+}
+
+// Function to write the ensemble settings to ensemble.txt:
+//     <members> <seed> <rain distribution> <rain spread> <temperature distribution> <temperature spread>
+int saveEnsembleSettings()
+{
+    char temp[256];
+    snprintf(temp, sizeof(temp), "%s.tmp", ensemble_file);
+
+    FILE *file = fopen(temp, "w");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    int ok = fprintf(file, "%d %llu %d %.17g %d %.17g\n", ensembleSettings.members, ensembleSettings.seed,
+                     ensembleSettings.rainDistribution, ensembleSettings.rainSpread,
+                     ensembleSettings.temperatureDistribution, ensembleSettings.temperatureSpread) > 0;
+    syncFile(file);
+    fclose(file);
+    if (!ok || !replaceFile(temp, ensemble_file))
+    {
+        remove(temp);
+        return 0;
+    }
+    return 1;
+}
+
+const char *ensembleDistributionNames[ENSEMBLE_DISTRIBUTIONS] = {"fixed", "normal", "lognormal", "uniform"};
+
+// Function to show the ensemble settings and let the admin change them
+void editEnsembleSettings()
+{
+    char answer;
+    EnsembleSettings settings = ensembleSettings;
+
+    printf("\033[1;34m"); // Blue for the current settings
+    printf("Members: %d, seed: %llu\n", settings.members, settings.seed);
+    printf("Rainfall: %s, spread %.2f\n", ensembleDistributionNames[settings.rainDistribution], settings.rainSpread);
+    printf("Temperature: %s, spread %.2f\n", ensembleDistributionNames[settings.temperatureDistribution], settings.temperatureSpread);
+    printf("\033[1;33m");
+    printf("\nChange the settings? (y/n): ");
+    scanf(" %c", &answer);
+    printf("\033[0m");
+    if (answer != 'y' && answer != 'Y')
+    {
+        return;
+    }
+
+    printf("\033[1;34m");
+    printf("Distributions: 0 = fixed, 1 = normal, 2 = lognormal (spread in log units), 3 = uniform\n");
+    printf("Enter members (1-%d): ", ENSEMBLE_MAX_MEMBERS);
+    printf("\033[1;33m");
+    scanf("%d", &settings.members);
+    printf("\033[1;34m");
+    printf("Enter seed: ");
+    printf("\033[1;33m");
+    scanf("%llu", &settings.seed);
+    printf("\033[1;34m");
+    printf("Enter rainfall distribution and spread: ");
+    printf("\033[1;33m");
+    scanf("%d %lf", &settings.rainDistribution, &settings.rainSpread);
+    printf("\033[1;34m");
+    printf("Enter temperature distribution and spread: ");
+    printf("\033[1;33m");
+    scanf("%d %lf", &settings.temperatureDistribution, &settings.temperatureSpread);
+    printf("\033[0m");
+
+    if (!validEnsembleSettings(&settings))
+    {
+        printf("\033[1;31m"); // Red for error
+        printf("Invalid settings, the previous ones are kept.\n");
+        printf("\033[0m");
+        return;
+    }
+    ensembleSettings = settings;
+    if (!saveEnsembleSettings())
+    {
+        printf("\033[1;31m");
+        printf("Error saving the ensemble settings.\n");
+        printf("\033[0m");
+    }
+}
+
+// Function to run the ensemble forecast of every station and show its percentiles
+void ensembleForecast()
+{
+    editEnsembleSettings();
+    loadingDotsAnimation(1, "Running");
+    clearScreen();
+
+    EnsembleResult *results = runEnsemble();
+    if (results == NULL)
+    {
+        printf("\033[1;31m"); // Red for error
+        printf("Error: not enough memory for the ensemble.\n");
+        printf("\033[0m");
+        return;
+    }
+
+    printf("\033[1;34m"); // Blue for header text
+    printf("Ensemble of %d members, seed %llu\n\n", ensembleSettings.members, ensembleSettings.seed);
+    printf("%-15s %-10s %-10s %-10s %-15s\n", "Area", "P10(M)", "P50(M)", "P90(M)", "P(danger)");
+    printf("--------------------------------------------------------------\n");
+    printf("\033[0m");
+    for (int i = 0; i < count; i++)
+    {
+        // Red when a danger level is likely, yellow when possible, green otherwise
+        printf(results[i].exceedance >= 0.5f ? "\033[1;31m" : results[i].exceedance > 0 ? "\033[1;33m" : "\033[1;32m");
+        printf("%-15s %-10.2f %-10.2f %-10.2f %5.1f%%\n", stations.location[i], results[i].p10, results[i].p50,
+               results[i].p90, results[i].exceedance * 100);
+        printf("\033[0m");
+    }
+    free(results);
+}
+
+///////////////////////// END /////////////////////////////
+
+////////////////// RIVER NETWORK ROUTING //////////////////////
+/*
+data_base/network.txt lists the river reaches between stations, one per line:
+    <upstream location> <downstream location> <travel hours> [<X> [<share>]]
+The travel time is the Muskingum K of the reach (at least 1 hour), X its
+weighting between inflow and outflow storage (0 to 0.5, RIVER_DEFAULT_X when
+left out), and share the part of the upstream flow that reaches the
+downstream station (1 when left out).
+
+Routing follows the rain-driven part of each station's level
+(alpha * rainfall * factor, receding like the lead-time forecasts; at a rated
+station factor is its curve's slope over those units) down the
+network hour by hour over ROUTING_HOURS, through the Muskingum equation
+    O(t + 1) = c0 * I(t + 1) + c1 * I(t) + c2 * O(t)
+of every reach. Each node's outflow is its own flow plus what its upstream
+reaches deliver. A reach carries nothing at hour 0: the current level of a
+station already reflects the flow that reached it, so routing leaves today's
+predictions alone and adds the upstream rain still on its way to the
+lead-time forecasts.
+
+Nodes are ordered in topological waves (a node's upstream nodes are all in
+earlier waves); the nodes of one wave, independent sub-basins included, are
+routed in parallel on the thread pool. Nodes on a cycle, and those below it,
+get no wave and no routed flow; loading network.txt warns about them.
+*/
+
+// rain-driven flow left after each routed hour
+float routingPersistence[ROUTING_HOURS + 1];
+int routingPersistenceReady = 0;
+
+// Function to find the node of a location in the river network, adding it when create is set; -1 if absent
+int findRiverNode(const char *location, int create)
+{
+    RiverNetwork *network = &riverNetwork;
+    unsigned int hash = hashLocation(location);
+
+    if (network->indexCapacity > 0)
+    {
+        unsigned int bucket = hash & (network->indexCapacity - 1);
+        while (network->index[bucket] != 0)
+        {
+            int node = network->index[bucket] - 1;
+            if (compareLocations(network->location[node], location) == 0)
+            {
+                return node;
+            }
+            bucket = (bucket + 1) & (network->indexCapacity - 1);
+        }
+    }
+    if (!create)
+    {
+        return -1;
+    }
+
+    if (network->nodeCount == network->nodeCapacity)
+    {
+        int capacity = network->nodeCapacity ? network->nodeCapacity * 2 : 64;
+        if (!growColumn((void **)&network->location, sizeof(char *), capacity))
+        {
+            return -1;
+        }
+        network->nodeCapacity = capacity;
+    }
+    if ((unsigned int)(network->nodeCount + 1) * 2 > network->indexCapacity)
+    {
+        // rebuild the index, at most half full
+        unsigned int capacity = network->indexCapacity ? network->indexCapacity * 2 : 128;
+        int *index = calloc(capacity, sizeof(int));
+        if (index == NULL)
+        {
+            return -1;
+        }
+        for (int node = 0; node < network->nodeCount; node++)
+        {
+            unsigned int bucket = hashLocation(network->location[node]) & (capacity - 1);
+            while (index[bucket] != 0)
+            {
+                bucket = (bucket + 1) & (capacity - 1);
+            }
+            index[bucket] = node + 1;
+        }
+        free(network->index);
+        network->index = index;
+        network->indexCapacity = capacity;
+    }
+
+    char *name = poolLocation(location);
+    if (name == NULL)
+    {
+        return -1;
+    }
+    int node = network->nodeCount++;
+    network->location[node] = name;
+    unsigned int bucket = hash & (network->indexCapacity - 1);
+    while (network->index[bucket] != 0)
+    {
+        bucket = (bucket + 1) & (network->indexCapacity - 1);
+    }
+    network->index[bucket] = node + 1;
+    return node;
+}
+
+// Function to add a reach to the river network; buildRiverNetwork has to run before routing with it
+int addRiverReach(const char *upstream, const char *downstream, double hours, double x, double share)
+{
+    RiverNetwork *network = &riverNetwork;
+    if (hours < 1 || x < 0 || x > 0.5 || share < 0 || compareLocations(upstream, downstream) == 0)
+    {
+        return 0;
+    }
+    if (network->reachCount == network->reachCapacity)
+    {
+        int capacity = network->reachCapacity ? network->reachCapacity * 2 : 64;
+        if (!growColumn((void **)&network->reaches, sizeof(RiverReach), capacity))
+        {
+            return 0;
+        }
+        network->reachCapacity = capacity;
+    }
+
+    RiverReach reach;
+    reach.upstream = findRiverNode(upstream, 1);
+    reach.downstream = findRiverNode(downstream, 1);
+    if (reach.upstream == -1 || reach.downstream == -1)
+    {
+        return 0;
+    }
+
+    // Muskingum coefficients for a 1 hour step; hours >= 1 and x <= 0.5 keep c2 >= 0
+    double storage = 2 * hours * (1 - x), lag = 2 * hours * x, denominator = storage + 1;
+    reach.c0 = (float)((1 - lag) / denominator);
+    reach.c1 = (float)((1 + lag) / denominator);
+    reach.c2 = (float)((storage - 1) / denominator);
+    reach.share = (float)share;
+    network->reaches[network->reachCount++] = reach;
+    return 1;
+}
+
+// Function to build the CSR upstream lists and the topological waves; returns the nodes left on cycles, -1 on error
+int buildRiverNetwork()
+{
+    RiverNetwork *network = &riverNetwork;
+    int nodes = network->nodeCount, reaches = network->reachCount;
+
+    free(network->inStart);
+    free(network->inReach);
+    free(network->order);
+    free(network->waveStart);
+    free(network->outflow);
+    free(network->routed);
+    network->inStart = calloc(nodes + 1, sizeof(int));
+    network->inReach = malloc((reaches > 0 ? reaches : 1) * sizeof(int));
+    network->order = malloc((nodes > 0 ? nodes : 1) * sizeof(int));
+    network->waveStart = malloc((nodes + 1) * sizeof(int));
+    network->outflow = calloc((size_t)(nodes > 0 ? nodes : 1) * (ROUTING_HOURS + 1), sizeof(float));
+    network->routed = calloc((size_t)(nodes > 0 ? nodes : 1) * LEAD_TIMES, sizeof(float));
+    network->waveCount = 0;
+    riverRoutingStale = 1;
+
+    // the downstream lists are only needed to order the nodes
+    int *outStart = calloc(nodes + 1, sizeof(int));
+    int *outReach = malloc((reaches > 0 ? reaches : 1) * sizeof(int));
+    int *remaining = malloc((nodes > 0 ? nodes : 1) * sizeof(int));
+    if (network->inStart == NULL || network->inReach == NULL || network->order == NULL || network->waveStart == NULL ||
+        network->outflow == NULL || network->routed == NULL || outStart == NULL || outReach == NULL || remaining == NULL)
+    {
+        free(outStart);
+        free(outReach);
+        free(remaining);
+        return -1;
+    }
+
+    // Counting sort of the reaches by downstream node (CSR) and by upstream node
+    for (int r = 0; r < reaches; r++)
+    {
+        network->inStart[network->reaches[r].downstream + 1]++;
+        outStart[network->reaches[r].upstream + 1]++;
+    }
+    for (int n = 0; n < nodes; n++)
+    {
+        network->inStart[n + 1] += network->inStart[n];
+        outStart[n + 1] += outStart[n];
+    }
+    for (int n = 0; n < nodes; n++)
+    {
+        remaining[n] = network->inStart[n]; // fill cursors first, reaches stay in file order
+    }
+    for (int r = 0; r < reaches; r++)
+    {
+        network->inReach[remaining[network->reaches[r].downstream]++] = r;
+    }
+    for (int n = 0; n < nodes; n++)
+    {
+        remaining[n] = outStart[n];
+    }
+    for (int r = 0; r < reaches; r++)
+    {
+        outReach[remaining[network->reaches[r].upstream]++] = r;
+    }
+
+    // Kahn's algorithm one wave at a time: a node joins the wave after its last upstream node
+    int ordered = 0;
+    for (int n = 0; n < nodes; n++)
+    {
+        remaining[n] = network->inStart[n + 1] - network->inStart[n];
+        if (remaining[n] == 0)
+        {
+            network->order[ordered++] = n;
+        }
+    }
+    int waveFirst = 0;
+    while (waveFirst < ordered)
+    {
+        int waveLast = ordered;
+        network->waveStart[network->waveCount++] = waveFirst;
+        for (int i = waveFirst; i < waveLast; i++)
+        {
+            int up = network->order[i];
+            for (int e = outStart[up]; e < outStart[up + 1]; e++)
+            {
+                int down = network->reaches[outReach[e]].downstream;
+                if (--remaining[down] == 0)
+                {
+                    network->order[ordered++] = down;
+                }
+            }
+        }
+        waveFirst = waveLast;
+    }
+    network->waveStart[network->waveCount] = ordered;
+
+    free(outStart);
+    free(outReach);
+    free(remaining);
+    return nodes - ordered;
+}
+
+// Function to route one node at time now: its own flow plus the routed flow of its upstream reaches
+void routeRiverNode(int node, long long now)
+{
+    RiverNetwork *network = &riverNetwork;
+    float *outflow = network->outflow + (size_t)node * (ROUTING_HOURS + 1);
+    float inflow[ROUTING_HOURS + 1] = {0};
+
+    float flow = 0, runoff[ROUTING_HOURS + 1];
+    int convolved = 0;
+    int slot = findLocation(network->location[node]);
+    if (slot != -1)
+    {
+        double parameters[MODEL_PARAMETERS];
+        getStationParameters(network->location[node], parameters);
+        const HistorySeries *delayed = stationHydrograph(network->location[node]);
+        convolved = delayed != NULL && hydrographRunoff(delayed, now / 3600, ROUTING_HOURS + 1, runoff);
+        double factor = parameters[PARAM_FACTOR];
+        if (stations.curve[slot] >= 0)
+        {
+            // a rated station's meters per unit come from its curve over the rain-driven units
+            float dry = (float)(parameters[PARAM_BETA] * stations.temperature[slot] + parameters[PARAM_GAMMA]);
+            factor = ratingSlope(stations.curve[slot], dry, dry + (float)(parameters[PARAM_ALPHA] * (convolved ? runoff[0] : stations.rainfall[slot])));
+        }
+        flow = (float)(parameters[PARAM_ALPHA] * (convolved ? 1 : stations.rainfall[slot]) * factor);
+    }
+
+    for (int e = network->inStart[node]; e < network->inStart[node + 1]; e++)
+    {
+        const RiverReach *reach = &network->reaches[network->inReach[e]];
+        const float *upstream = network->outflow + (size_t)reach->upstream * (ROUTING_HOURS + 1);
+        float routed = 0;
+        for (int t = 1; t <= ROUTING_HOURS; t++)
+        {
+            routed = reach->c0 * upstream[t] + reach->c1 * upstream[t - 1] + reach->c2 * routed;
+            if (routed < 0)
+            {
+                routed = 0; // a negative c0 can dip below zero as the flow rises
+            }
+            inflow[t] += reach->share * routed;
+        }
+    }
+
+    for (int t = 0; t <= ROUTING_HOURS; t++)
+    {
+        outflow[t] = flow * (convolved ? runoff[t] : routingPersistence[t]) + inflow[t];
+    }
+    for (int k = 0; k < LEAD_TIMES; k++)
+    {
+        network->routed[node * LEAD_TIMES + k] = inflow[leadHours[k]];
+    }
+}
+
+// one topological wave handed to the thread pool
+typedef struct
+{
+    int first, last; // positions in the order
+    long long now;   // one clock reading for the whole network
+} RoutingWave;
+
+// Function to route one block of a topological wave (a thread pool task)
+void routeWaveTask(int task, void *arg)
+{
+    const RoutingWave *wave = arg;
+    int first = wave->first + task * ROUTING_BLOCK;
+    int last = first + ROUTING_BLOCK < wave->last ? first + ROUTING_BLOCK : wave->last;
+
+    for (int i = first; i < last; i++)
+    {
+        routeRiverNode(riverNetwork.order[i], wave->now);
+    }
+}
+
+// Function to route the whole network, wave after wave
+void routeRiverNetwork()
+{
+    if (!routingPersistenceReady)
+    {
+        for (int t = 0; t <= ROUTING_HOURS; t++)
+        {
+            routingPersistence[t] = (float)exp(-t / RAIN_RECESSION_HOURS);
+        }
+        routingPersistenceReady = 1;
+    }
+
+    long long now = (long long)time(NULL);
+    for (int w = 0; w < riverNetwork.waveCount; w++)
+    {
+        RoutingWave wave = {riverNetwork.waveStart[w], riverNetwork.waveStart[w + 1], now};
+        runParallel((wave.last - wave.first + ROUTING_BLOCK - 1) / ROUTING_BLOCK, routeWaveTask, &wave);
+    }
+    riverRoutingStale = 0;
+}
+
+// Function to get the flow a station receives from upstream at lead time k, in meters (0 off the network)
+float riverInflow(const char *location, int k)
+{
+    if (riverNetwork.nodeCount == 0 || riverNetwork.routed == NULL)
+    {
+        return 0;
+    }
+    int node = findRiverNode(location, 0);
+    if (node == -1)
+    {
+        return 0;
+    }
+    if (riverRoutingStale)
+    {
+        routeRiverNetwork();
+    }
+    return riverNetwork.routed[node * LEAD_TIMES + k];
+}
+
+// Function to warn about the stations buildRiverNetwork left unordered by a cycle, which get no routed flow
+void reportRiverCycles(int stuck)
+{
+    RiverNetwork *network = &riverNetwork;
+    char *ordered = calloc(network->nodeCount, 1);
+    if (ordered == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < network->waveStart[network->waveCount]; i++)
+    {
+        ordered[network->order[i]] = 1;
+    }
+
+    printf("\033[1;33m"); // Yellow for warning message
+    printf("Warning: %d station%s on or below a cycle in network.txt, not routed:", stuck, stuck == 1 ? " is" : "s are");
+    for (int n = 0, shown = 0; n < network->nodeCount && shown < RIVER_CYCLE_NAMES; n++)
+    {
+        if (!ordered[n])
+        {
+            printf(" %s", network->location[n]);
+            shown++;
+        }
+    }
+    printf(stuck > RIVER_CYCLE_NAMES ? " ...\n" : "\n");
+    printf("\033[0m"); // Reset color
+    free(ordered);
+}
+
+// Function to load the river reaches from network.txt and order them, returns how many were loaded
+int loadRiverNetwork()
+{
+    LineReader reader;
+    if (!openLineReader(&reader, network_file))
+    {
+        return 0;
+    }
+
+    const char *line;
+    size_t length;
+    int loaded = 0;
+    while (nextLine(&reader, &line, &length))
+    {
+        TextField fields[5];
+        char upstream[MAX_LOCATION_LENGTH], downstream[MAX_LOCATION_LENGTH];
+        double values[3] = {0, RIVER_DEFAULT_X, 1}; // hours, X, share
+        int count = splitFields(line, length, fields, 5);
+        int ok = count >= 3 && count <= 5 && copyField(&fields[0], upstream, sizeof(upstream)) && copyField(&fields[1], downstream, sizeof(downstream));
+        for (int f = 2; f < count && ok; f++)
+        {
+            ok = parseDoubleField(&fields[f], &values[f - 2]);
+        }
+        if (ok && addRiverReach(upstream, downstream, values[0], values[1], values[2]))
+        {
+            loaded++;
+        }
+    }
+    closeLineReader(&reader);
+
+    int stuck = loaded > 0 ? buildRiverNetwork() : 0;
+    if (stuck < 0)
+    {
+        return 0;
+    }
+    if (stuck > 0)
+    {
+        reportRiverCycles(stuck);
+    }
+    return loaded;
+}
+
+///////////////////////// END /////////////////////////////
+
+////////////////// GAUGE FILTER //////////////////////
+/*
+Every station with observed levels in gauges.txt gets a Kalman filter whose
+state is the model's error split in two (see KALMAN_ERROR_HOURS):
+    observed level = model level + error + bias + gauge noise
+Between readings the error decays by exp(-hours / KALMAN_ERROR_HOURS) and the
+bias's variance grows by KALMAN_BIAS_DRIFT^2 per hour; each reading then pulls
+both toward the difference it shows. A level the model predicts at a later
+time is corrected by the decayed error plus the bias, which is what the
+forecast screens show. State and covariance are kept column-wise, and the
+update kernels run one reading per station for a whole round of stations at
+once (AVX2 does four stations per step). Like the other batch kernels they
+repeat the scalar arithmetic step by step, so every kernel gives bit-identical
+states.
+*/
+
+// Function to find the filter row of a location, adding a fresh one when create is set (-1 when absent)
+int findFilterRow(const char *location, int create)
+{
+    GaugeFilter *filter = &gaugeFilter;
+    unsigned int hash = hashLocation(location);
+
+    if (filter->indexCapacity > 0)
+    {
+        unsigned int bucket = hash & (filter->indexCapacity - 1);
+        while (filter->index[bucket] != 0)
+        {
+            int row = filter->index[bucket] - 1;
+            if (compareLocations(filter->location[row], location) == 0)
+            {
+                return row;
+            }
+            bucket = (bucket + 1) & (filter->indexCapacity - 1);
+        }
+    }
+    if (!create)
+    {
+        return -1;
+    }
+
+    if (filter->count == filter->capacity)
+    {
+        int capacity = filter->capacity ? filter->capacity * 2 : 64;
+        if (!growColumn((void **)&filter->error, sizeof(double), capacity) || !growColumn((void **)&filter->bias, sizeof(double), capacity) ||
+            !growColumn((void **)&filter->p00, sizeof(double), capacity) || !growColumn((void **)&filter->p01, sizeof(double), capacity) ||
+            !growColumn((void **)&filter->p11, sizeof(double), capacity) || !growColumn((void **)&filter->time, sizeof(long long), capacity) ||
+            !growColumn((void **)&filter->location, sizeof(char *), capacity))
+        {
+            return -1;
+        }
+        filter->capacity = capacity;
+    }
+    if ((unsigned int)(filter->count + 1) * 2 > filter->indexCapacity)
+    {
+        // rebuild the index, at most half full
+        unsigned int capacity = filter->indexCapacity ? filter->indexCapacity * 2 : 128;
+        int *index = calloc(capacity, sizeof(int));
+        if (index == NULL)
+        {
+            return -1;
+        }
+        for (int row = 0; row < filter->count; row++)
+        {
+            unsigned int bucket = hashLocation(filter->location[row]) & (capacity - 1);
+            while (index[bucket] != 0)
+            {
+                bucket = (bucket + 1) & (capacity - 1);
+            }
+            index[bucket] = row + 1;
+        }
+        free(filter->index);
+        filter->index = index;
+        filter->indexCapacity = capacity;
+    }
+
+    char *name = poolLocation(location);
+    if (name == NULL)
+    {
+        return -1;
+    }
+    int row = filter->count++;
+    filter->location[row] = name;
+    filter->error[row] = 0;
+    filter->bias[row] = 0;
+    filter->p00[row] = KALMAN_ERROR_SD * KALMAN_ERROR_SD;
+    filter->p01[row] = 0;
+    filter->p11[row] = KALMAN_BIAS_SD * KALMAN_BIAS_SD;
+    filter->time[row] = 0;
+    unsigned int bucket = hash & (filter->indexCapacity - 1);
+    while (filter->index[bucket] != 0)
+    {
+        bucket = (bucket + 1) & (filter->indexCapacity - 1);
+    }
+    filter->index[bucket] = row + 1;
+    return row;
+}
+
+// Function to drop every filter row (the model they corrected has changed)
+void clearGaugeFilter()
+{
+    gaugeFilter.count = 0;
+    gaugeFilter.offset = 0; // every reading is assimilated again
+    if (gaugeFilter.index != NULL)
+    {
+        memset(gaugeFilter.index, 0, gaugeFilter.indexCapacity * sizeof(int));
+    }
+}
+
+// Function to load the filter state saved by saveGaugeFilter; without it, or when gauges.txt is shorter
+// than the part it covers, every reading is assimilated again. Returns the number of rows loaded.
+int loadGaugeFilter()
+{
+    LineReader reader;
+    if (!openLineReader(&reader, filter_file))
+    {
+        return 0;
+    }
+    const char *line;
+    size_t length;
+    TextField fields[7];
+    char text[32], *end;
+    long long size, stamp;
+    fileStamp(gauge_file, &size, &stamp);
+    if (!nextLine(&reader, &line, &length) || splitFields(line, length, fields, 1) != 1 || !copyField(&fields[0], text, sizeof(text)) ||
+        (gaugeFilter.offset = strtoll(text, &end, 10)) < 0 || *end != '\0' || gaugeFilter.offset > size)
+    {
+        closeLineReader(&reader);
+        clearGaugeFilter();
+        return 0;
+    }
+
+    int ok = 1;
+    while (ok && nextLine(&reader, &line, &length))
+    {
+        char location[MAX_LOCATION_LENGTH];
+        double values[5];
+        ok = splitFields(line, length, fields, 7) == 7 && copyField(&fields[0], location, sizeof(location)) &&
+             copyField(&fields[1], text, sizeof(text));
+        long long time = ok ? strtoll(text, &end, 10) : 0;
+        ok = ok && *end == '\0';
+        for (int v = 0; v < 5 && ok; v++)
+        {
+            ok = parseDoubleField(&fields[v + 2], &values[v]);
+        }
+        int row = ok ? findFilterRow(location, 1) : -1;
+        ok = row != -1;
+        if (ok)
+        {
+            gaugeFilter.time[row] = time;
+            gaugeFilter.error[row] = values[0];
+            gaugeFilter.bias[row] = values[1];
+            gaugeFilter.p00[row] = values[2];
+            gaugeFilter.p01[row] = values[3];
+            gaugeFilter.p11[row] = values[4];
+        }
+    }
+    closeLineReader(&reader);
+    if (!ok)
+    {
+        clearGaugeFilter(); // a damaged state file: start over from the first reading
+    }
+    return gaugeFilter.count;
+}
+
+// Function to write the filter state and how far into gauges.txt it goes to gauge_filter.txt
+int saveGaugeFilter()
+{
+    char temp[256];
+    snprintf(temp, sizeof(temp), "%s.tmp", filter_file);
+
+    FILE *file = fopen(temp, "w");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    int ok = fprintf(file, "%lld\n", gaugeFilter.offset) > 0;
+    for (int row = 0; row < gaugeFilter.count && ok; row++)
+    {
+        // %.17g round-trips, so a restart continues from exactly this state
+        ok = fprintf(file, "%s %lld %.17g %.17g %.17g %.17g %.17g\n", gaugeFilter.location[row], gaugeFilter.time[row], gaugeFilter.error[row],
+                     gaugeFilter.bias[row], gaugeFilter.p00[row], gaugeFilter.p01[row], gaugeFilter.p11[row]) > 0;
+    }
+    syncFile(file);
+    fclose(file);
+    if (!ok || !replaceFile(temp, filter_file))
+    {
+        remove(temp);
+        return 0;
+    }
+    return 1;
+}
+
+// Function to get how much the gauges correct a station's model level at the given time, 0 without readings
+float gaugeCorrection(const char *location, long long time)
+{
+    if (gaugeFilter.count == 0)
+    {
+        return 0;
+    }
+    int row = findFilterRow(location, 0);
+    if (row == -1 || gaugeFilter.time[row] == 0)
+    {
+        return 0;
+    }
+    double hours = (time - gaugeFilter.time[row]) / 3600.0;
+    double decay = hours > 0 ? exp(-hours / KALMAN_ERROR_HOURS) : 1;
+    return (float)(decay * gaugeFilter.error[row] + gaugeFilter.bias[row]);
+}
+
+// Scalar update kernel for lanes [first, last), also used for the tail of the vector kernel
+void kalman_update_batch_scalar(const KalmanBatch *batch, int first, int last)
+{
+    const double errorVariance = KALMAN_ERROR_SD * KALMAN_ERROR_SD;
+    const double drift = KALMAN_BIAS_DRIFT * KALMAN_BIAS_DRIFT;
+    const double noise = KALMAN_GAUGE_SD * KALMAN_GAUGE_SD;
+    for (int i = first; i < last; i++)
+    {
+        // carry the state to the reading: the error fades, the bias grows less certain
+        double decay = batch->decay[i];
+        double error = decay * batch->error[i], bias = batch->bias[i];
+        double p00 = decay * decay * batch->p00[i] + errorVariance * (1 - decay * decay);
+        double p01 = decay * batch->p01[i];
+        double p11 = batch->p11[i] + drift * batch->hours[i];
+
+        // the reading measures model + error + bias
+        double innovation = batch->observed[i] - (batch->predicted[i] + error + bias);
+        double g0 = p00 + p01, g1 = p01 + p11;
+        double inverse = 1 / (g0 + g1 + noise); // of the innovation variance
+        double k0 = g0 * inverse, k1 = g1 * inverse;
+
+        batch->error[i] = error + k0 * innovation;
+        batch->bias[i] = bias + k1 * innovation;
+        batch->p00[i] = p00 - k0 * g0;
+        batch->p01[i] = p01 - k0 * g1;
+        batch->p11[i] = p11 - k1 * g1;
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+// AVX2 update kernel: 4 stations per step
+__attribute__((target("avx2"))) void kalman_update_batch_avx2(const KalmanBatch *batch, int first, int last)
+{
+    const __m256d errorVariance = _mm256_set1_pd(KALMAN_ERROR_SD * KALMAN_ERROR_SD);
+    const __m256d drift = _mm256_set1_pd(KALMAN_BIAS_DRIFT * KALMAN_BIAS_DRIFT);
+    const __m256d noise = _mm256_set1_pd(KALMAN_GAUGE_SD * KALMAN_GAUGE_SD);
+    const __m256d one = _mm256_set1_pd(1);
+    int i = first;
+
+    for (; i + 4 <= last; i += 4)
+    {
+        __m256d decay = _mm256_loadu_pd(batch->decay + i), decay2 = _mm256_mul_pd(decay, decay);
+        __m256d error = _mm256_mul_pd(decay, _mm256_loadu_pd(batch->error + i)), bias = _mm256_loadu_pd(batch->bias + i);
+        __m256d p00 = _mm256_add_pd(_mm256_mul_pd(decay2, _mm256_loadu_pd(batch->p00 + i)), _mm256_mul_pd(errorVariance, _mm256_sub_pd(one, decay2)));
+        __m256d p01 = _mm256_mul_pd(decay, _mm256_loadu_pd(batch->p01 + i));
+        __m256d p11 = _mm256_add_pd(_mm256_loadu_pd(batch->p11 + i), _mm256_mul_pd(drift, _mm256_loadu_pd(batch->hours + i)));
+
+        __m256d innovation = _mm256_sub_pd(_mm256_loadu_pd(batch->observed + i), _mm256_add_pd(_mm256_add_pd(_mm256_loadu_pd(batch->predicted + i), error), bias));
+        __m256d g0 = _mm256_add_pd(p00, p01), g1 = _mm256_add_pd(p01, p11);
+        __m256d inverse = _mm256_div_pd(one, _mm256_add_pd(_mm256_add_pd(g0, g1), noise));
+        __m256d k0 = _mm256_mul_pd(g0, inverse), k1 = _mm256_mul_pd(g1, inverse);
+
+        _mm256_storeu_pd(batch->error + i, _mm256_add_pd(error, _mm256_mul_pd(k0, innovation)));
+        _mm256_storeu_pd(batch->bias + i, _mm256_add_pd(bias, _mm256_mul_pd(k1, innovation)));
+        _mm256_storeu_pd(batch->p00 + i, _mm256_sub_pd(p00, _mm256_mul_pd(k0, g0)));
+        _mm256_storeu_pd(batch->p01 + i, _mm256_sub_pd(p01, _mm256_mul_pd(k0, g1)));
+        _mm256_storeu_pd(batch->p11 + i, _mm256_sub_pd(p11, _mm256_mul_pd(k1, g1)));
+    }
+    kalman_update_batch_scalar(batch, i, last);
+}
+#endif
+
+// update kernel picked for this CPU on first use
+void (*kalmanUpdateKernel)(const KalmanBatch *, int, int) = NULL;
+OnceFlag kalmanUpdateSelected = ONCE_INIT;
+
+// Function to pick the update kernel for this CPU
+void selectKalmanUpdateKernel()
+{
+    kalmanUpdateKernel = kalman_update_batch_scalar;
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        kalmanUpdateKernel = kalman_update_batch_avx2;
+    }
+#endif
+}
+
+// Function to assimilate one reading into each of lanes [first, last) with the best kernel
+void kalman_update_batch(const KalmanBatch *batch, int first, int last)
+{
+    runOnce(&kalmanUpdateSelected, selectKalmanUpdateKernel);
+    kalmanUpdateKernel(batch, first, last);
+}
+
+///////////////////////// END /////////////////////////////
+
+///////////////// PREDICTION SIDECAR INDEX /////////////////
+
+// Function to derive the sidecar index path from the predictions file path (predictions.txt -> predictions.idx)
+void predictionIndexPath(const char *prediction_file, char *path, size_t size)
+{
+    snprintf(path, size, "%s", prediction_file);
+    char *extension = strrchr(path, '.');
+    if (extension != NULL && strchr(extension, '/') == NULL)
+    {
+        *extension = '\0';
+    }
+    strncat(path, ".idx", size - strlen(path) - 1);
+}
+
+// Function to get the size of an open file, used to detect a stale sidecar index
+long long fileSize(FILE *file)
+{
+    long position = ftell(file);
+    fseek(file, 0, SEEK_END);
+    long long size = ftell(file);
+    fseek(file, position, SEEK_SET);
+    return size;
+}
+
+// Function to write the sidecar index (hashed location -> byte offset of the row) next to the predictions file
+void writePredictionIndex(const char *prediction_file, const unsigned int *hashes, const long long *offsets, int rows, long long predictionsSize)
+{
+    char path[256];
+    predictionIndexPath(prediction_file, path, sizeof(path));
+
+    unsigned int capacity = 16;
+    while (capacity < 2u * (unsigned int)rows)
+    {
+        capacity *= 2; // power of two and at most half full
+    }
+
+    PredictionIndexEntry *table = calloc(capacity, sizeof(PredictionIndexEntry));
+    if (table == NULL)
+    {
+        remove(path); // better no index than a stale one
+        return;
+    }
+
+    for (int i = 0; i < rows; i++)
+    {
+        unsigned int bucket = hashes[i] & (capacity - 1);
+        while (table[bucket].offset != 0)
+        {
+            bucket = (bucket + 1) & (capacity - 1);
+        }
+        table[bucket].hash = hashes[i];
+        table[bucket].offset = offsets[i] + 1;
+    }
+
+    // Written aside and renamed, so a reader that has the old index mapped keeps a complete file
+    PredictionIndexHeader header = {{'F', 'P', 'I', 'X'}, PREDICTION_INDEX_VERSION, capacity, (unsigned int)rows, 0, predictionsSize, 0};
+    char temp[260];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE *file = fopen(temp, "wb");
+    if (file != NULL)
+    {
+        int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(table, sizeof(PredictionIndexEntry), capacity, file) == capacity;
+        ok = fclose(file) == 0 && ok;
+        if (!ok || !replaceFile(temp, path))
+        {
+            remove(temp);
+            remove(path);
+        }
+    }
+    else
+    {
+        remove(path);
+    }
+    free(table);
+}
+
+// Function to check a sidecar index header against the size of the predictions file it should describe
+int validPredictionIndexHeader(const PredictionIndexHeader *header, long long predictionsSize)
+{
+    return memcmp(header->magic, "FPIX", 4) == 0 && header->version == PREDICTION_INDEX_VERSION &&
+           header->capacity != 0 && (header->capacity & (header->capacity - 1)) == 0 &&
+           header->predictionsSize == predictionsSize;
+}
+
+// Function to read and validate the sidecar index header against the open predictions file
+int readPredictionIndexHeader(FILE *index, FILE *predictions, PredictionIndexHeader *header)
+{
+    rewind(index);
+    return fread(header, sizeof(*header), 1, index) == 1 && validPredictionIndexHeader(header, fileSize(predictions));
+}
+
+// Function to read one bucket of the sidecar index
+int readPredictionIndexEntry(FILE *index, unsigned int bucket, PredictionIndexEntry *entry)
+{
+    fseek(index, (long)(sizeof(PredictionIndexHeader) + (size_t)bucket * sizeof(PredictionIndexEntry)), SEEK_SET);
+    return fread(entry, sizeof(*entry), 1, index) == 1;
+}
+
+// Function to walk the probe chain of a location.
+// Returns 1 and sets *bucket and forecast when found, 0 when not found (*bucket is then the first
+// reusable bucket of the chain), -1 on a read error.
+int probePredictionIndex(FILE *index, const PredictionIndexHeader *header, FILE *predictions, const char *location, ForecastData *forecast, unsigned int *bucket)
+{
+    unsigned int hash = hashLocation(location);
+    unsigned int current = hash & (header->capacity - 1);
+    int freeFound = 0;
+    PredictionIndexEntry entry;
+
+    for (unsigned int probes = 0; probes < header->capacity; probes++)
+    {
+        if (!readPredictionIndexEntry(index, current, &entry))
+        {
+            return -1;
+        }
+        if (entry.offset <= 0 && !freeFound)
+        {
+            *bucket = current; // first empty or deleted bucket, where an insert would go
+            freeFound = 1;
+        }
+        if (entry.offset == 0)
+        {
+            return 0; // empty bucket ends the probe chain
+        }
+        if (entry.offset > 0 && entry.hash == hash)
+        {
+            char line[512];
+            fseek(predictions, (long)(entry.offset - 1), SEEK_SET);
+            if (fgets(line, sizeof(line), predictions) != NULL &&
+                parsePredictionLine(line, strcspn(line, "\n"), forecast) &&
+                strcasecmp(forecast->location, location) == 0)
+            {
+                *bucket = current;
+                return 1;
+            }
+        }
+        current = (current + 1) & (header->capacity - 1);
+    }
+    return freeFound ? 0 : -1;
+}
+
+// Function to look up a location through the sidecar index.
+// Returns 1 and fills forecast when found, 0 when not found, -1 when the index is missing or stale.
+int lookupPredictionIndex(FILE *predictions, const char *prediction_file, const char *location, ForecastData *forecast)
+{
+    char path[256];
+    predictionIndexPath(prediction_file, path, sizeof(path));
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    PredictionIndexHeader header;
+    unsigned int bucket;
+    int result = -1;
+    if (readPredictionIndexHeader(file, predictions, &header))
+    {
+        result = probePredictionIndex(file, &header, predictions, location, forecast, &bucket);
+    }
+
+    fclose(file);
+    return result;
+}
+
+// Function to look up a location through a mapped sidecar index in a mapped predictions file.
+// Returns 1 and fills forecast when found, 0 when not found, -1 when the index is missing or stale.
+int lookupMappedPredictionIndex(const char *predictions, size_t size, const char *prediction_file, const char *location, ForecastData *forecast)
+{
+    char path[256];
+    predictionIndexPath(prediction_file, path, sizeof(path));
+
+    MappedFile index;
+    if (!mapFile(path, &index, 0))
+    {
+        return -1;
+    }
+
+    int result = -1;
+    const PredictionIndexHeader *header = (const PredictionIndexHeader *)index.data;
+    if (index.size >= sizeof(*header) && validPredictionIndexHeader(header, (long long)size) &&
+        (index.size - sizeof(*header)) / sizeof(PredictionIndexEntry) >= header->capacity)
+    {
+        const PredictionIndexEntry *table = (const PredictionIndexEntry *)(index.data + sizeof(*header));
+        unsigned int hash = hashLocation(location);
+        unsigned int bucket = hash & (header->capacity - 1);
+
+        result = 0;
+        for (unsigned int probes = 0; probes < header->capacity && table[bucket].offset != 0; probes++)
+        {
+            long long offset = table[bucket].offset - 1;
+            if (offset >= 0 && offset < (long long)size && table[bucket].hash == hash)
+            {
+                const char *row = predictions + offset;
+                const char *end = memchr(row, '\n', size - (size_t)offset);
+                size_t length = end != NULL ? (size_t)(end - row) : size - (size_t)offset;
+                if (parsePredictionLine(row, length, forecast) && strcasecmp(forecast->location, location) == 0)
+                {
+                    result = 1;
+                    break;
+                }
+            }
+            bucket = (bucket + 1) & (header->capacity - 1);
+        }
+    }
+
+    unmapFile(&index);
+    return result;
+}
+
+///////////////// END /////////////////
+
+///////////////// SHOW FORCAST TO USER LOCATION /////////////////
+
+// Function to print one forecast row
+void printForecast(const ForecastData *data)
+{
+    // The model's levels are corrected by the station's observed gauge levels when it has any
+    long long now = (long long)time(NULL);
+    double parameters[MODEL_PARAMETERS];
+    getStationParameters(data->location, parameters);
+    float correction = gaugeCorrection(data->location, now);
+    float waterLevel = data->waterLevel + correction;
+    const char *alertStatus = correction == 0 ? data->alertStatus : waterLevel > parameters[PARAM_THRESHOLD] ? "ON" : "OFF";
+
+    // Forecast section with green for location name and blue for other details
+    printf("\033[1;32m"); // Green for location name
+    printf("Location: %s\n", data->location);
+    printf("\033[1;34m"); // Blue for other data
+    printf("Temperature: %.2f°C\n", data->temperature);
+    printf("Rainfall: %.2f mm\n", data->rainfall);
+    printf("Water Level: %.2f m\n", waterLevel);
+    if (correction != 0)
+    {
+        printf("  (model %.2f m, %+.2f m from observed gauge levels)\n", data->waterLevel, correction);
+    }
+
+    // Color change for alert status: red for "ON", green for "OFF"
+    if (strcasecmp(alertStatus, "ON") == 0)
+    {
+        printf("\033[1;31m"); // Red for alert ON
+    }
+    else
+    {
+        printf("\033[1;32m"); // Green for alert OFF
+    }
+    printf("Alert: %s\n", alertStatus);
+
+    // The forecast horizon of the station, from the resident lead-time forecasts
+    int slot = findLocation(data->location);
+    if (slot != -1 && slot < leadCapacity)
+    {
+        printf("\033[1;34m");
+        printf("Forecast (no further rain):\n");
+        for (int k = 0; k < LEAD_TIMES; k++)
+        {
+            float level = leadLevels[slot * LEAD_TIMES + k] + riverInflow(data->location, k);
+            level += gaugeCorrection(data->location, now + leadHours[k] * 3600LL);
+            printf("\033[1;34m");
+            printf("  +%-3dh  %8.2f m  ", leadHours[k], level);
+            printf(level > parameters[PARAM_THRESHOLD] ? "\033[1;31mALERT\n" : "\033[1;32msafe\n");
+        }
+    }
+
+    // How uncertain the current level is, from the ensemble of this station
+    float members[ENSEMBLE_MAX_MEMBERS];
+    EnsembleResult ensemble;
+    ensembleStation(findStationParameters(data->location), findRatingCurve(data->location), data->location, data->rainfall,
+                    data->temperature, now, members, &ensemble);
+    printf("\033[1;34m");
+    printf("Ensemble (%d members): P10 %.2f m, P50 %.2f m, P90 %.2f m\n", ensembleSettings.members, ensemble.p10, ensemble.p50, ensemble.p90);
+    printf(ensemble.exceedance >= 0.5f ? "\033[1;31m" : ensemble.exceedance > 0 ? "\033[1;33m" : "\033[1;32m");
+    printf("Chance of exceeding the danger level: %.1f%%\n", ensemble.exceedance * 100);
+    printf("\033[0m"); // Reset color
+}
+
+void showForecast(const char *location)
+{
+    LineReader reader;
+    if (!openMappedLineReader(&reader, prediction_file))
+    {
+        printf("\033[1;31m"); // Red for error message
+        printf("Error opening predictions file.\n");
+        printf("\033[0m"); // Reset color
+        return;
+    }
+
+    ForecastData data;
+    int found = 0;
+
+    // Unknown locations are answered from the index without touching the predictions file
+    if (findLocation(location) != -1)
+    {
+        // Seek straight to the row through the sidecar index
+        if (reader.mapped)
+        {
+            found = lookupMappedPredictionIndex(reader.data, reader.size, prediction_file, location, &data);
+        }
+        else
+        {
+            FILE *file = fopen(prediction_file, "rb"); // binary so the sidecar offsets are exact
+            found = file != NULL ? lookupPredictionIndex(file, prediction_file, location, &data) : -1;
+            if (file != NULL)
+            {
+                fclose(file);
+            }
+        }
+
+        if (found == -1)
+        {
+            // No usable index: read each line of the file and search for the location
+            const char *line;
+            size_t length;
+            found = 0;
+            while (nextLine(&reader, &line, &length))
+            {
+                if (parsePredictionLine(line, length, &data) && strcasecmp(data.location, location) == 0)
+                { // Case-insensitive comparison
+                    found = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (found)
+    {
+        printForecast(&data);
+    }
+    else
+    {
+        // If location not found, show error in red
+        printf("\033[1;31m"); // Red for error message
+        printf("Location '%s' not found in the forecast data.\n", location);
+        printf("\033[0m"); // Reset color
+    }
+
+    closeLineReader(&reader);
+}
+
+//////////////////// SHOW FORCAST TO SEARCH LOCATION //////////////
+void searchOtherLocation()
+{
+    char location[MAX_LOCATION_LENGTH];
+
+    // Enhance the input prompt color with blue
+    printf("\033[1;33m"); // Blue for the prompt text
+    printf("Enter location to search: ");
+    printf("\033[0m"); // Reset color
+
+    // Using scanf for input
+    printf("\033[1;33m");
+    scanf("%49s", location);
+    printf("\033[0m");
+    
+    clearScreen();
+    printf("\033[1;33m"); // Green for searching another location
+    loadingDotsAnimation(2, "Searching Forecast");
+    //printf("\nSearching for forecast in another location...\n");
+    printf("\033[0m");
+
+    delay(2);
+
+    // Call showForecast with cyan text color for the output
+    printf("\033[1;36m"); // Cyan for the forecast output
+    clearScreen();
+    showForecast(location);
+    printf("\033[0m"); // Reset color after displaying forecast
+}
+
+////////////// END //////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// 232-35-002 /////////////////////////////////////////////////////////////////
+
+////////////////// PREDICTION ALGORITHOM//////////////////////
+
+// Function to calculate water level based on the given formula
+float calculate_water_level(float rainfall, float temperature)
+{
+    float water_level = (ALPHA * rainfall) + (BETA * temperature) + GAMMA;
+    return water_level * CONVENTION_FACTOR;
+}
+
+// Function to tell whether the model uses accumulated rainfall (not with the default weights)
+int rainfallAccumulationEnabled()
+{
+    return RAIN_24H_WEIGHT != 0 || RAIN_72H_WEIGHT != 0 || RAIN_7D_WEIGHT != 0;
+}
+
+// Function to tell whether some station predicts with anything but the batch kernels' constants
+int stationModelsCustomized()
+{
+    return stationParameters.count > 0 || rainfallAccumulationEnabled() || hydrographCount > 0 || ratingCurves.count > 0;
+}
+
+// Function to calculate a station's water level with its own coefficients (parameter row, -1 for the
+// defaults), accumulated rainfall and rating curve (-1 for CONVENTION_FACTOR); the arithmetic matches
+// calculate_water_level for the defaults
+float station_water_level(int row, int curve, const char *location, float rainfall, float temperature, long long now, int *alert)
+{
+    double parameters[MODEL_PARAMETERS];
+    for (int p = 0; p < MODEL_PARAMETERS; p++)
+    {
+        parameters[p] = row < 0 ? defaultParameters[p] : stationParameters.column[p][row];
+    }
+
+    // with a unit hydrograph the rain of the past hours arrives now instead of the latest reading
+    const HistorySeries *delayed = stationHydrograph(location);
+    float runoff;
+    if (delayed != NULL && hydrographRunoff(delayed, now / 3600, 1, &runoff))
+    {
+        rainfall = runoff;
+    }
+
+    float water_level = (parameters[PARAM_ALPHA] * rainfall) + (parameters[PARAM_BETA] * temperature) + parameters[PARAM_GAMMA];
+    double accumulated = 0;
+    if (parameters[PARAM_RAIN_24H] != 0 || parameters[PARAM_RAIN_72H] != 0 || parameters[PARAM_RAIN_7D] != 0)
+    {
+        float sums[RAIN_WINDOWS];
+        rollingRainfall(location, now, sums);
+        accumulated = parameters[PARAM_RAIN_24H] * sums[0] + parameters[PARAM_RAIN_72H] * sums[1] + parameters[PARAM_RAIN_7D] * sums[2];
+    }
+    if (curve >= 0)
+    {
+        water_level = ratingStage(curve, water_level + (float)accumulated);
+    }
+    else
+    {
+        water_level = water_level * parameters[PARAM_FACTOR];
+        water_level += (float)(accumulated * parameters[PARAM_FACTOR]);
+    }
+    *alert = water_level > parameters[PARAM_THRESHOLD];
+    return water_level;
+}
+
+// Share of the current rainfall's effect left at each lead time, filled once on first use
+double leadPersistence[LEAD_TIMES];
+OnceFlag leadPersistenceReady = ONCE_INIT;
+
+// Function to fill leadPersistence
+void prepareLeadPersistence()
+{
+    for (int k = 0; k < LEAD_TIMES; k++)
+    {
+        leadPersistence[k] = exp(-leadHours[k] / RAIN_RECESSION_HOURS);
+    }
+}
+
+// Function to calculate a station's water levels at every lead time with its own coefficients and
+// rating curve (as for station_water_level); accumulated rainfall is taken as it is now
+void station_lead_levels(int row, int curve, const char *location, float rainfall, float temperature, long long now, float levels[LEAD_TIMES])
+{
+    double parameters[MODEL_PARAMETERS];
+    for (int p = 0; p < MODEL_PARAMETERS; p++)
+    {
+        parameters[p] = row < 0 ? defaultParameters[p] : stationParameters.column[p][row];
+    }
+
+    double accumulated = 0;
+    if (parameters[PARAM_RAIN_24H] != 0 || parameters[PARAM_RAIN_72H] != 0 || parameters[PARAM_RAIN_7D] != 0)
+    {
+        float sums[RAIN_WINDOWS];
+        rollingRainfall(location, now, sums);
+        accumulated = parameters[PARAM_RAIN_24H] * sums[0] + parameters[PARAM_RAIN_72H] * sums[1] + parameters[PARAM_RAIN_7D] * sums[2];
+    }
+    runOnce(&leadPersistenceReady, prepareLeadPersistence);
+    const HistorySeries *delayed = stationHydrograph(location);
+    float runoff[ROUTING_HOURS + 1];
+    int convolved = delayed != NULL && hydrographRunoff(delayed, now / 3600, ROUTING_HOURS + 1, runoff);
+    for (int k = 0; k < LEAD_TIMES; k++)
+    {
+        // the hydrograph's runoff still to come, or the current rainfall receding
+        double rain = convolved ? parameters[PARAM_ALPHA] * runoff[leadHours[k]] : parameters[PARAM_ALPHA] * rainfall * leadPersistence[k];
+        float water_level = rain + (parameters[PARAM_BETA] * temperature) + parameters[PARAM_GAMMA];
+        if (curve >= 0)
+        {
+            levels[k] = ratingStage(curve, water_level + (float)accumulated);
+        }
+        else
+        {
+            levels[k] = (float)(water_level * parameters[PARAM_FACTOR]) + (float)(accumulated * parameters[PARAM_FACTOR]);
+        }
+    }
+}
+
+// Function to tell whether a station's level differs from what the batch kernels computed
+int needsStationModel(int row, const char *location)
+{
+    return row >= 0 || rainfallAccumulationEnabled() || stationHydrograph(location) != NULL;
+}
+
+// Function to call visit(slot, arg) for the slots in [first, last) that need the station model, and with
+// rated also those that only have a rating curve. Ranges larger than the number of calibrated, delayed and
+// rated stations walk those and find their slots instead of testing every slot.
+void forEachModelledSlot(int first, int last, int rated, void (*visit)(int slot, void *arg), void *arg)
+{
+    int models = stationParameters.count + hydrographCount + (rated ? ratingCurves.count : 0);
+    if (rainfallAccumulationEnabled() || last - first <= models)
+    {
+        for (int i = first; i < last; i++)
+        {
+            if (needsStationModel(stations.parameters[i], stations.location[i]) || (rated && stations.curve[i] >= 0))
+            {
+                visit(i, arg);
+            }
+        }
+        return;
+    }
+
+    for (int row = 0; row < stationParameters.count; row++)
+    {
+        int slot = findLocation(stationParameters.location[row]);
+        if (slot >= first && slot < last)
+        {
+            visit(slot, arg);
+        }
+    }
+    for (int s = 0; s < historySeriesCount && hydrographCount > 0; s++)
+    {
+        int slot = historySeries[s].hydrograph != NULL ? findLocation(historySeries[s].location) : -1;
+        if (slot >= first && slot < last && stations.parameters[slot] < 0) // calibrated ones were visited above
+        {
+            visit(slot, arg);
+        }
+    }
+    for (int curve = 0; rated && curve < ratingCurves.count; curve++)
+    {
+        int slot = findLocation(ratingCurves.location[curve]);
+        if (slot >= first && slot < last && !needsStationModel(stations.parameters[slot], stations.location[slot]))
+        {
+            visit(slot, arg);
+        }
+    }
+}
+
+///////////////////////// END /////////////////////////////
+
+////////////////// BATCH WATER LEVEL KERNELS //////////////////////
+/*
+The batch kernels compute calculate_water_level for stations [first, last) of
+the given columns and set alert bit i (bit i % 64 of word i / 64) where the
+level is above THRESHOLD_WATER_LEVEL. They repeat the scalar function's arithmetic step by step:
+the weighted sum in double, rounded to float, then scaled by CONVENTION_FACTOR in
+double and rounded to float again, so every kernel gives bit-identical results.
+(This holds as long as the build doesn't fuse multiply-adds, e.g. -ffast-math.)
+*/
+
+// Scalar kernel, also used for the unaligned head and the tail of the vector kernels
+void calculate_water_level_batch_scalar(const float *rainfall, const float *temperature, float *waterLevel, unsigned long long *alerts, int first, int last)
+{
+    for (int i = first; i < last; i++)
+    {
+        waterLevel[i] = calculate_water_level(rainfall[i], temperature[i]);
+        setAlertBit(alerts, i, waterLevel[i] > THRESHOLD_WATER_LEVEL);
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+// SSE2 kernel: 4 stations per step
+__attribute__((target("sse2"))) void calculate_water_level_batch_sse2(const float *rainfall, const float *temperature, float *waterLevel, unsigned long long *alerts, int first, int last)
+{
+    const __m128d alpha = _mm_set1_pd(ALPHA), beta = _mm_set1_pd(BETA), gamma = _mm_set1_pd(GAMMA);
+    const __m128d factor = _mm_set1_pd(CONVENTION_FACTOR);
+    const __m128 threshold = _mm_set1_ps(THRESHOLD_WATER_LEVEL);
+    int i = (first + 3) & ~3; // groups of 4 never straddle two alert words
+
+    if (i > last)
+    {
+        i = last;
+    }
+    calculate_water_level_batch_scalar(rainfall, temperature, waterLevel, alerts, first, i);
+    for (; i + 4 <= last; i += 4)
+    {
+        __m128 r = _mm_loadu_ps(rainfall + i), t = _mm_loadu_ps(temperature + i);
+        __m128d rLow = _mm_cvtps_pd(r), rHigh = _mm_cvtps_pd(_mm_movehl_ps(r, r));
+        __m128d tLow = _mm_cvtps_pd(t), tHigh = _mm_cvtps_pd(_mm_movehl_ps(t, t));
+
+        // float water_level = (ALPHA * rainfall) + (BETA * temperature) + GAMMA;
+        __m128d low = _mm_add_pd(_mm_add_pd(_mm_mul_pd(alpha, rLow), _mm_mul_pd(beta, tLow)), gamma);
+        __m128d high = _mm_add_pd(_mm_add_pd(_mm_mul_pd(alpha, rHigh), _mm_mul_pd(beta, tHigh)), gamma);
+        __m128 sum = _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high));
+
+        // return water_level * CONVENTION_FACTOR;
+        low = _mm_mul_pd(_mm_cvtps_pd(sum), factor);
+        high = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(sum, sum)), factor);
+        __m128 level = _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high));
+
+        _mm_storeu_ps(waterLevel + i, level);
+        unsigned long long mask = (unsigned long long)_mm_movemask_ps(_mm_cmpgt_ps(level, threshold));
+        alerts[i >> 6] = (alerts[i >> 6] & ~(0xFULL << (i & 63))) | (mask << (i & 63));
+    }
+    calculate_water_level_batch_scalar(rainfall, temperature, waterLevel, alerts, i, last);
+}
+
+// AVX2 kernel: 8 stations per step
+__attribute__((target("avx2"))) void calculate_water_level_batch_avx2(const float *rainfall, const float *temperature, float *waterLevel, unsigned long long *alerts, int first, int last)
+{
+    const __m256d alpha = _mm256_set1_pd(ALPHA), beta = _mm256_set1_pd(BETA), gamma = _mm256_set1_pd(GAMMA);
+    const __m256d factor = _mm256_set1_pd(CONVENTION_FACTOR);
+    const __m256 threshold = _mm256_set1_ps(THRESHOLD_WATER_LEVEL);
+    int i = (first + 7) & ~7; // groups of 8 never straddle two alert words
+
+    if (i > last)
+    {
+        i = last;
+    }
+    calculate_water_level_batch_scalar(rainfall, temperature, waterLevel, alerts, first, i);
+    for (; i + 8 <= last; i += 8)
+    {
+        __m256d rLow = _mm256_cvtps_pd(_mm_loadu_ps(rainfall + i)), rHigh = _mm256_cvtps_pd(_mm_loadu_ps(rainfall + i + 4));
+        __m256d tLow = _mm256_cvtps_pd(_mm_loadu_ps(temperature + i)), tHigh = _mm256_cvtps_pd(_mm_loadu_ps(temperature + i + 4));
+
+        __m256d low = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(alpha, rLow), _mm256_mul_pd(beta, tLow)), gamma);
+        __m256d high = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(alpha, rHigh), _mm256_mul_pd(beta, tHigh)), gamma);
+        __m128 sumLow = _mm256_cvtpd_ps(low), sumHigh = _mm256_cvtpd_ps(high);
+
+        __m128 levelLow = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(sumLow), factor));
+        __m128 levelHigh = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(sumHigh), factor));
+        __m256 level = _mm256_insertf128_ps(_mm256_castps128_ps256(levelLow), levelHigh, 1);
+
+        _mm256_storeu_ps(waterLevel + i, level);
+        unsigned long long mask = (unsigned long long)_mm256_movemask_ps(_mm256_cmp_ps(level, threshold, _CMP_GT_OQ));
+        alerts[i >> 6] = (alerts[i >> 6] & ~(0xFFULL << (i & 63))) | (mask << (i & 63));
+    }
+    calculate_water_level_batch_scalar(rainfall, temperature, waterLevel, alerts, i, last);
+}
+#endif
+
+// kernel picked for this CPU on first use, once even when pool tasks get there together
+void (*waterLevelKernel)(const float *, const float *, float *, unsigned long long *, int, int) = NULL;
+OnceFlag waterLevelSelected = ONCE_INIT;
+
+// Function to pick the fastest kernel the CPU supports
+void selectWaterLevelKernel()
+{
+    waterLevelKernel = calculate_water_level_batch_scalar;
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        waterLevelKernel = calculate_water_level_batch_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        waterLevelKernel = calculate_water_level_batch_sse2;
+    }
+#endif
+}
+
+// Function to compute water levels and alert bits for stations [first, last) with the best kernel
+void calculate_water_level_batch(const float *rainfall, const float *temperature, float *waterLevel, unsigned long long *alerts, int first, int last)
+{
+    runOnce(&waterLevelSelected, selectWaterLevelKernel);
+    waterLevelKernel(rainfall, temperature, waterLevel, alerts, first, last);
+}
+
+/*
+The rated kernels do the same for stations some of which convert units through
+a rating curve: curves[i - first] is station i's curve, or -1 for
+CONVENTION_FACTOR. A rated station's stage is ratingStage of the weighted sum
+rounded to float. The AVX2 kernel gathers eight stations' curve offsets and
+knots at once and blends them over the factor's levels, skipping the gathers
+for groups without a rated station, so the batch stays branch-free per station
+and bit-identical to the scalar kernel.
+*/
+
+// Scalar rated kernel, also used for the unaligned head and the tail of the vector kernel
+void calculate_rated_levels_batch_scalar(const float *rainfall, const float *temperature, const int *curves, float *waterLevel, unsigned long long *alerts, int first, int last)
+{
+    for (int i = first; i < last; i++)
+    {
+        int curve = curves[i - first];
+        if (curve >= 0)
+        {
+            float units = (ALPHA * rainfall[i]) + (BETA * temperature[i]) + GAMMA;
+            waterLevel[i] = ratingStage(curve, units);
+        }
+        else
+        {
+            waterLevel[i] = calculate_water_level(rainfall[i], temperature[i]);
+        }
+        setAlertBit(alerts, i, waterLevel[i] > THRESHOLD_WATER_LEVEL);
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+// AVX2 rated kernel: 8 stations per step
+__attribute__((target("avx2"))) void calculate_rated_levels_batch_avx2(const float *rainfall, const float *temperature, const int *curves, float *waterLevel, unsigned long long *alerts, int first, int last)
+{
+    const __m256d alpha = _mm256_set1_pd(ALPHA), beta = _mm256_set1_pd(BETA), gamma = _mm256_set1_pd(GAMMA);
+    const __m256d factor = _mm256_set1_pd(CONVENTION_FACTOR);
+    const __m256 threshold = _mm256_set1_ps(THRESHOLD_WATER_LEVEL);
+    const __m256 lastCell = _mm256_set1_ps(RATING_POINTS - 2);
+    const __m256i points = _mm256_set1_epi32(RATING_POINTS), none = _mm256_set1_epi32(-1);
+    int i = (first + 7) & ~7; // groups of 8 never straddle two alert words
+
+    if (i > last)
+    {
+        i = last;
+    }
+    calculate_rated_levels_batch_scalar(rainfall, temperature, curves, waterLevel, alerts, first, i);
+    for (; i + 8 <= last; i += 8)
+    {
+        __m256d rLow = _mm256_cvtps_pd(_mm_loadu_ps(rainfall + i)), rHigh = _mm256_cvtps_pd(_mm_loadu_ps(rainfall + i + 4));
+        __m256d tLow = _mm256_cvtps_pd(_mm_loadu_ps(temperature + i)), tHigh = _mm256_cvtps_pd(_mm_loadu_ps(temperature + i + 4));
+
+        __m256d low = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(alpha, rLow), _mm256_mul_pd(beta, tLow)), gamma);
+        __m256d high = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(alpha, rHigh), _mm256_mul_pd(beta, tHigh)), gamma);
+        __m128 sumLow = _mm256_cvtpd_ps(low), sumHigh = _mm256_cvtpd_ps(high);
+
+        __m128 levelLow = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(sumLow), factor));
+        __m128 levelHigh = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(sumHigh), factor));
+        __m256 level = _mm256_insertf128_ps(_mm256_castps128_ps256(levelLow), levelHigh, 1);
+
+        __m256i curve = _mm256_loadu_si256((const __m256i *)(curves + i - first));
+        __m256i rated = _mm256_cmpgt_epi32(curve, none);
+        if (!_mm256_testz_si256(rated, rated))
+        {
+            // ratingStage for every lane, stations without a curve read curve 0 and are blended out
+            __m256i safe = _mm256_max_epi32(curve, _mm256_setzero_si256());
+            __m256 units = _mm256_insertf128_ps(_mm256_castps128_ps256(sumLow), sumHigh, 1);
+            __m256 x = _mm256_mul_ps(_mm256_sub_ps(units, _mm256_i32gather_ps(ratingCurves.low, safe, 4)), _mm256_i32gather_ps(ratingCurves.scale, safe, 4));
+            __m256i cell = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()), lastCell));
+            __m256i knot = _mm256_add_epi32(_mm256_mullo_epi32(safe, points), cell);
+            __m256 k0 = _mm256_i32gather_ps(ratingCurves.knots, knot, 4), k1 = _mm256_i32gather_ps(ratingCurves.knots + 1, knot, 4);
+            __m256 stage = _mm256_add_ps(k0, _mm256_mul_ps(_mm256_sub_ps(x, _mm256_cvtepi32_ps(cell)), _mm256_sub_ps(k1, k0)));
+            level = _mm256_blendv_ps(level, stage, _mm256_castsi256_ps(rated));
+        }
+
+        _mm256_storeu_ps(waterLevel + i, level);
+        unsigned long long mask = (unsigned long long)_mm256_movemask_ps(_mm256_cmp_ps(level, threshold, _CMP_GT_OQ));
+        alerts[i >> 6] = (alerts[i >> 6] & ~(0xFFULL << (i & 63))) | (mask << (i & 63));
+    }
+    calculate_rated_levels_batch_scalar(rainfall, temperature, curves + (i - first), waterLevel, alerts, i, last);
+}
+#endif
+
+// rated kernel picked for this CPU on first use
+void (*ratedLevelKernel)(const float *, const float *, const int *, float *, unsigned long long *, int, int) = NULL;
+OnceFlag ratedLevelSelected = ONCE_INIT;
+
+// Function to pick the rated kernel for this CPU
+void selectRatedLevelKernel()
+{
+    ratedLevelKernel = calculate_rated_levels_batch_scalar;
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        ratedLevelKernel = calculate_rated_levels_batch_avx2;
+    }
+#endif
+}
+
+// Function to compute water levels and alert bits for stations [first, last) where curves gives their rating curves
+void calculate_rated_levels_batch(const float *rainfall, const float *temperature, const int *curves, float *waterLevel, unsigned long long *alerts, int first, int last)
+{
+    runOnce(&ratedLevelSelected, selectRatedLevelKernel);
+    ratedLevelKernel(rainfall, temperature, curves, waterLevel, alerts, first, last);
+}
+
+// Function to compute water levels and alert bits for stations [first, last) with their rating curves,
+// looking the curves up by name a block at a time; name(i) gives station i's location
+void calculate_station_levels(const float *rainfall, const float *temperature, const char *(*name)(int i, const void *names),
+                              const void *names, float *waterLevel, unsigned long long *alerts, int first, int last)
+{
+    if (ratingCurves.count == 0)
+    {
+        calculate_water_level_batch(rainfall, temperature, waterLevel, alerts, first, last);
+        return;
+    }
+    int curves[RATING_BLOCK];
+    for (int block = first; block < last; block += RATING_BLOCK)
+    {
+        int end = last - block < RATING_BLOCK ? last : block + RATING_BLOCK;
+        for (int i = block; i < end; i++)
+        {
+            curves[i - block] = findRatingCurve(name(i, names));
+        }
+        calculate_rated_levels_batch(rainfall, temperature, curves, waterLevel, alerts, block, end);
+    }
+}
+
+// Function to compute water levels and alert bits for rows [first, last) that are table slots [first, last),
+// with the rating curves the slots point at
+void calculate_slot_levels(const float *rainfall, const float *temperature, float *waterLevel, unsigned long long *alerts, int first, int last)
+{
+    if (ratingCurves.count == 0)
+    {
+        calculate_water_level_batch(rainfall, temperature, waterLevel, alerts, first, last);
+        return;
+    }
+    calculate_rated_levels_batch(rainfall, temperature, stations.curve + first, waterLevel, alerts, first, last);
+}
+
+/*
+The lead kernels fill LEAD_TIMES consecutive levels per station for stations
+[first, last) with the default coefficients. Every horizon comes out of one
+pass: a station's inputs are loaded and converted once and its rainfall and
+temperature terms are shared, only the decayed rainfall term differs per lead.
+Like the water level kernels they repeat the scalar arithmetic step by step,
+so every kernel gives bit-identical levels.
+*/
+
+// Scalar lead kernel, also used for the tail of the vector kernel
+void calculate_lead_levels_batch_scalar(const float *rainfall, const float *temperature, float *levels, int first, int last)
+{
+    for (int i = first; i < last; i++)
+    {
+        double rain = ALPHA * rainfall[i], heat = BETA * temperature[i];
+        for (int k = 0; k < LEAD_TIMES; k++)
+        {
+            float water_level = (rain * leadPersistence[k]) + heat + GAMMA;
+            levels[i * LEAD_TIMES + k] = (float)(water_level * CONVENTION_FACTOR);
+        }
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+// AVX2 lead kernel: 8 stations per step, one vector per lead, interleaved per station on the way out
+__attribute__((target("avx2"))) void calculate_lead_levels_batch_avx2(const float *rainfall, const float *temperature, float *levels, int first, int last)
+{
+    const __m256d alpha = _mm256_set1_pd(ALPHA), beta = _mm256_set1_pd(BETA), gamma = _mm256_set1_pd(GAMMA);
+    const __m256d factor = _mm256_set1_pd(CONVENTION_FACTOR);
+    float block[LEAD_TIMES][8];
+    int i = first;
+
+    for (; i + 8 <= last; i += 8)
+    {
+        __m256d rainLow = _mm256_mul_pd(alpha, _mm256_cvtps_pd(_mm_loadu_ps(rainfall + i)));
+        __m256d rainHigh = _mm256_mul_pd(alpha, _mm256_cvtps_pd(_mm_loadu_ps(rainfall + i + 4)));
+        __m256d heatLow = _mm256_mul_pd(beta, _mm256_cvtps_pd(_mm_loadu_ps(temperature + i)));
+        __m256d heatHigh = _mm256_mul_pd(beta, _mm256_cvtps_pd(_mm_loadu_ps(temperature + i + 4)));
+
+        for (int k = 0; k < LEAD_TIMES; k++)
+        {
+            __m256d persistence = _mm256_set1_pd(leadPersistence[k]);
+            __m128 sumLow = _mm256_cvtpd_ps(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(rainLow, persistence), heatLow), gamma));
+            __m128 sumHigh = _mm256_cvtpd_ps(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(rainHigh, persistence), heatHigh), gamma));
+            _mm_storeu_ps(block[k], _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(sumLow), factor)));
+            _mm_storeu_ps(block[k] + 4, _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(sumHigh), factor)));
+        }
+        for (int j = 0; j < 8; j++)
+        {
+            for (int k = 0; k < LEAD_TIMES; k++)
+            {
+                levels[(i + j) * LEAD_TIMES + k] = block[k][j];
+            }
+        }
+    }
+    calculate_lead_levels_batch_scalar(rainfall, temperature, levels, i, last);
+}
+#endif
+
+// lead kernel picked for this CPU on first use
+void (*leadLevelKernel)(const float *, const float *, float *, int, int) = NULL;
+OnceFlag leadLevelSelected = ONCE_INIT;
+
+// Function to pick the lead kernel for this CPU
+void selectLeadLevelKernel()
+{
+    leadLevelKernel = calculate_lead_levels_batch_scalar;
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        leadLevelKernel = calculate_lead_levels_batch_avx2;
+    }
+#endif
+}
+
+// Function to compute the lead-time levels of stations [first, last) with the best kernel
+void calculate_lead_levels_batch(const float *rainfall, const float *temperature, float *levels, int first, int last)
+{
+    runOnce(&leadPersistenceReady, prepareLeadPersistence);
+    runOnce(&leadLevelSelected, selectLeadLevelKernel);
+    leadLevelKernel(rainfall, temperature, levels, first, last);
+}
+
+// Function to redo the lead-time forecasts of one slot with its station model (for forEachModelledSlot)
+void redoSlotLeadLevels(int slot, void *arg)
+{
+    float *levels = &leadLevels[slot * LEAD_TIMES];
+    if (stations.curve[slot] >= 0 && stations.parameters[slot] < 0 && hydrographCount == 0 && !rainfallAccumulationEnabled())
+    {
+        // only a rating curve: station_lead_levels' arithmetic on the default coefficients
+        double rain = ALPHA * stations.rainfall[slot], heat = BETA * stations.temperature[slot];
+        for (int k = 0; k < LEAD_TIMES; k++)
+        {
+            float water_level = (rain * leadPersistence[k]) + heat + GAMMA;
+            levels[k] = ratingStage(stations.curve[slot], water_level);
+        }
+        return;
+    }
+    station_lead_levels(stations.parameters[slot], stations.curve[slot], stations.location[slot], stations.rainfall[slot], stations.temperature[slot], *(const long long *)arg, levels);
+}
+
+// Function to fill the lead-time forecasts of stations [first, last)
+void computeLeadForecasts(int first, int last)
+{
+    if (stations.capacity > leadCapacity)
+    {
+        if (!growColumn((void **)&leadLevels, LEAD_TIMES * sizeof(float), stations.capacity))
+        {
+            return;
+        }
+        leadCapacity = stations.capacity;
+    }
+
+    calculate_lead_levels_batch(stations.rainfall, stations.temperature, leadLevels, first, last);
+    riverRoutingStale = 1; // downstream stations may depend on these
+    if (stationModelsCustomized())
+    {
+        long long now = (long long)time(NULL);
+        forEachModelledSlot(first, last, 1, redoSlotLeadLevels, &now);
+    }
+}
+
+// Function to redo the water level and alert bit of one slot with its station model (for forEachModelledSlot)
+void redoSlotWaterLevel(int slot, void *arg)
+{
+    int alert;
+    stations.waterLevel[slot] = station_water_level(stations.parameters[slot], stations.curve[slot], stations.location[slot], stations.rainfall[slot],
+                                                    stations.temperature[slot], *(const long long *)arg, &alert);
+    setAlertBit(stations.alerts, slot, alert);
+}
+
+// Function to fill the water level and alert columns for stations [first, last), and their
+// lead-time forecasts; only reads the two input columns
+void computeWaterLevels(int first, int last)
+{
+    calculate_slot_levels(stations.rainfall, stations.temperature, stations.waterLevel, stations.alerts, first, last);
+    if (stationModelsCustomized())
+    {
+        // stations on the defaults or only a rating curve keep the kernel's result, the calibrated ones are redone
+        long long now = (long long)time(NULL);
+        forEachModelledSlot(first, last, 0, redoSlotWaterLevel, &now);
+    }
+    computeLeadForecasts(first, last);
+}
+
+///////////////////////// END /////////////////////////////
+
+////////////////// UPDATE PREDICTIONS WITH NEW DATA//////////////////////
+
+// Rows of an update_predictions run, split into chunks formatted by the thread pool
+typedef struct
+{
+    char (*names)[MAX_LOCATION_LENGTH];
+    float *rainfall;
+    float *temperature;
+    float *waterLevel;
+    unsigned long long *alerts;
+    int rows;
+    int mirrored;  // row i is table slot i, so rows use the slot-aligned model columns
+    long long now; // time the station models predict for
+    int chunkRows; // multiple of 64 so chunks never share an alert word
+    unsigned int *hashes;
+    long long *offsets; // NULL when the sidecar index is skipped
+    char **text;        // formatted rows of each chunk
+    size_t *length;
+} PredictionJob;
+
+// Function to get the location of row i of a prediction job (for calculate_station_levels)
+const char *predictionRowName(int i, const void *names)
+{
+    return ((const char(*)[MAX_LOCATION_LENGTH])names)[i];
+}
+
+// Function to tell whether a station's slot, if it has one, is also its row in a prediction job
+int predictionRowIsSlot(const PredictionJob *job, const char *location)
+{
+    int slot = findLocation(location);
+    return slot == -1 || compareLocations(job->names[slot], location) == 0;
+}
+
+// Function to tell whether the rows of a prediction job are the table's slots. data.txt is written from
+// the table in slot order, so it is enough that the row counts agree and every calibrated, delayed or
+// rated station's slot holds its row; a file that doesn't mirror the table looks its models up by name.
+int predictionRowsMirrorTable(const PredictionJob *job)
+{
+    if (job->rows != count)
+    {
+        return 0;
+    }
+    for (int row = 0; row < stationParameters.count; row++)
+    {
+        if (!predictionRowIsSlot(job, stationParameters.location[row]))
+        {
+            return 0;
+        }
+    }
+    for (int s = 0; s < historySeriesCount && hydrographCount > 0; s++)
+    {
+        if (historySeries[s].hydrograph != NULL && !predictionRowIsSlot(job, historySeries[s].location))
+        {
+            return 0;
+        }
+    }
+    for (int curve = 0; curve < ratingCurves.count; curve++)
+    {
+        if (!predictionRowIsSlot(job, ratingCurves.location[curve]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Function to redo the water level and alert bit of a prediction row that is a modelled slot (for forEachModelledSlot)
+void redoPredictionRow(int row, void *arg)
+{
+    PredictionJob *job = arg;
+    int alert;
+    job->waterLevel[row] = station_water_level(stations.parameters[row], stations.curve[row], job->names[row], job->rainfall[row], job->temperature[row], job->now, &alert);
+    setAlertBit(job->alerts, row, alert);
+}
+
+// Function to compute and format one chunk of prediction rows into its own buffer
+void formatPredictionChunk(int chunk, void *arg)
+{
+    PredictionJob *job = arg;
+    int first = chunk * job->chunkRows;
+    int last = first + job->chunkRows < job->rows ? first + job->chunkRows : job->rows;
+
+    // Calculate water levels and alert bits using the formula and the stations' rating curves;
+    // stations on the defaults or only a rating curve keep the kernel's result, the calibrated ones are redone
+    if (job->mirrored)
+    {
+        calculate_slot_levels(job->rainfall, job->temperature, job->waterLevel, job->alerts, first, last);
+        if (stationModelsCustomized())
+        {
+            forEachModelledSlot(first, last, 0, redoPredictionRow, job);
+        }
+    }
+    else
+    {
+        calculate_station_levels(job->rainfall, job->temperature, predictionRowName, job->names, job->waterLevel, job->alerts, first, last);
+        for (int row = first; row < last && stationModelsCustomized(); row++)
+        {
+            int parameters = findStationParameters(job->names[row]), alert;
+            if (needsStationModel(parameters, job->names[row]))
+            {
+                job->waterLevel[row] = station_water_level(parameters, findRatingCurve(job->names[row]), job->names[row], job->rainfall[row], job->temperature[row], job->now, &alert);
+                setAlertBit(job->alerts, row, alert);
+            }
+        }
+    }
+
+    TextBuffer text = {NULL, 0, 0};
+    int ok = reserveText(&text, (size_t)(last - first) * 40 + MAX_ROW_LENGTH); // typical row size, grown as needed
+    for (int row = first; row < last && ok; row++)
+    {
+        if (!reserveText(&text, MAX_ROW_LENGTH))
+        {
+            ok = 0;
+            break;
+        }
+
+        if (job->offsets != NULL)
+        {
+            job->hashes[row] = hashLocation(job->names[row]);
+            job->offsets[row] = (long long)text.length; // made absolute once chunk sizes are known
+        }
+        // Alert status comes from the alert bit the kernel set against the water level threshold
+        text.length += formatPredictionText(text.data + text.length, job->names[row], job->rainfall[row], job->temperature[row], job->waterLevel[row], alertBit(job->alerts, row));
+    }
+    if (!ok)
+    {
+        free(text.data);
+        text.data = NULL;
+    }
+    job->text[chunk] = text.data;
+    job->length[chunk] = ok ? text.length : 0;
+}
+
+// Function to free everything update_predictions allocated for a job
+void freePredictionJob(PredictionJob *job, int chunks)
+{
+    for (int i = 0; i < chunks && job->text != NULL; i++)
+    {
+        free(job->text[i]);
+    }
+    free(job->names);
+    free(job->rainfall);
+    free(job->temperature);
+    free(job->waterLevel);
+    free(job->alerts);
+    free(job->hashes);
+    free(job->offsets);
+    free(job->text);
+    free(job->length);
+}
+
+// Function to update predictions and alert status in a new prediction file
+void update_predictions(const char *input_file, const char *output_file)
+{
+    // Read every station into columns (in parallel) so the pool can split them into chunks
+    StationColumns columns;
+    if (!parseStationFile(input_file, &columns))
+    {
+        printf("\033[1;31m"); // Red for error message
+        printf("Error: Could not open prediction file.\n");
+        printf("\033[0m"); // Reset color
+        return;
+    }
+
+    PredictionJob job = {0};
+    job.names = columns.names;
+    job.rainfall = columns.rainfall;
+    job.temperature = columns.temperature;
+    job.rows = columns.rows;
+    job.mirrored = predictionRowsMirrorTable(&job);
+    job.now = (long long)time(NULL);
+
+    // One chunk per pool thread, never smaller than a block
+    int threads = threadPoolSize();
+    job.chunkRows = (job.rows + threads - 1) / threads;
+    job.chunkRows = job.chunkRows < PREDICTION_BLOCK ? PREDICTION_BLOCK : (job.chunkRows + 63) & ~63;
+    int chunks = (job.rows + job.chunkRows - 1) / job.chunkRows;
+
+    job.waterLevel = malloc(((size_t)job.rows + 1) * sizeof(float));
+    job.alerts = calloc((size_t)job.rows / 64 + 1, sizeof(unsigned long long));
+    job.text = calloc((size_t)chunks + 1, sizeof(char *));
+    job.length = calloc((size_t)chunks + 1, sizeof(size_t));
+    job.hashes = malloc(((size_t)job.rows + 1) * sizeof(unsigned int));
+    job.offsets = malloc(((size_t)job.rows + 1) * sizeof(long long));
+    if (job.hashes == NULL || job.offsets == NULL) // out of memory: skip the index
+    {
+        free(job.hashes);
+        free(job.offsets);
+        job.hashes = NULL;
+        job.offsets = NULL;
+    }
+    if (job.waterLevel == NULL || job.alerts == NULL || job.text == NULL || job.length == NULL)
+    {
+        printf("\033[1;31m"); // Red for error message
+        printf("Error: Not enough memory to update predictions.\n");
+        printf("\033[0m"); // Reset color
+        freePredictionJob(&job, chunks);
+        return;
+    }
+
+    runParallel(chunks, formatPredictionChunk, &job);
+    for (int i = 0; i < chunks; i++)
+    {
+        if (job.text[i] == NULL)
+        {
+            printf("\033[1;31m"); // Red for error message
+            printf("Error: Not enough memory to update predictions.\n");
+            printf("\033[0m"); // Reset color
+            freePredictionJob(&job, chunks);
+            return;
+        }
+    }
+
+    // Open a new file for writing the predictions, written aside so readers mapping the old file
+    // keep a complete copy until the rename
+    char temp[260];
+    snprintf(temp, sizeof(temp), "%s.tmp", output_file);
+    FILE *prediction_file = fopen(temp, "wb");
+    if (prediction_file == NULL)
+    {
+        printf("\033[1;31m"); // Red for error message
+        printf("Error: Could not create prediction file.\n");
+        printf("\033[0m"); // Reset color
+        freePredictionJob(&job, chunks);
+        return;
+    }
+
+    // Concatenate the chunks in station order
+    long long offset = 0;
+    for (int i = 0; i < chunks; i++)
+    {
+        if (job.offsets != NULL)
+        {
+            int last = (i + 1) * job.chunkRows < job.rows ? (i + 1) * job.chunkRows : job.rows;
+            for (int row = i * job.chunkRows; row < last; row++)
+            {
+                job.offsets[row] += offset;
+            }
+        }
+        fwrite(job.text[i], 1, job.length[i], prediction_file);
+        offset += (long long)job.length[i];
+    }
+    int written = !ferror(prediction_file);
+    written = fclose(prediction_file) == 0 && written;
+
+    // The old index must not outlive the old predictions
+    char path[256];
+    predictionIndexPath(output_file, path, sizeof(path));
+    remove(path);
+    if (!written || !replaceFile(temp, output_file))
+    {
+        remove(temp);
+        printf("\033[1;31m"); // Red for error message
+        printf("Error: Could not create prediction file.\n");
+        printf("\033[0m"); // Reset color
+        freePredictionJob(&job, chunks);
+        return;
+    }
+
+    // Refresh the sidecar index so showForecast can seek straight to a row
+    if (job.offsets != NULL)
+    {
+        writePredictionIndex(output_file, job.hashes, job.offsets, job.rows, offset);
+    }
+    freePredictionJob(&job, chunks);
+}
+
+//////////////////////////// END ///////////////////////////////////////
+
+////////////////// PATCH PREDICTIONS FOR CHANGED STATIONS //////////////////////
+
+// Function to format the prediction row of a station exactly like update_predictions does
+int formatPredictionRow(char *row, size_t size, int slot)
+{
+    int alert;
+    float predicted_water_level = station_water_level(stations.parameters[slot], stations.curve[slot], stations.location[slot],
+                                                      stations.rainfall[slot], stations.temperature[slot], (long long)time(NULL), &alert);
+
+    stations.waterLevel[slot] = predicted_water_level;
+    setAlertBit(stations.alerts, slot, alert);
+    computeLeadForecasts(slot, slot + 1);
+    if (size < MAX_ROW_LENGTH)
+    {
+        return -1;
+    }
+    return formatPredictionText(row, stations.location[slot], stations.rainfall[slot], stations.temperature[slot], predicted_water_level, alert);
+}
+
+// Function to measure the row starting at offset, newline included
+long long rowLength(FILE *file, long long offset)
+{
+    long long length = 0;
+    int c;
+
+    fseek(file, (long)offset, SEEK_SET);
+    while ((c = fgetc(file)) != EOF)
+    {
+        length++;
+        if (c == '\n')
+        {
+            break;
+        }
+    }
+    return length;
+}
+
+// Function to overwrite a row with spaces, keeping its newline
+void blankRow(FILE *file, long long offset, long long length)
+{
+    fseek(file, (long)offset, SEEK_SET);
+    for (long long i = 0; i < length - 1; i++)
+    {
+        fputc(' ', file);
+    }
+}
+
+// Function to patch the rows of the pending stations into the predictions file and its sidecar index.
+// Returns 0 when the files can't be patched (missing or stale index, I/O error) or are due for a
+// rebuild: more blanked bytes than live ones, or the index more than half full counting tombstones.
+int patchPredictionRows(const char *output_file)
+{
+    char path[256];
+    predictionIndexPath(output_file, path, sizeof(path));
+
+    FILE *predictions = fopen(output_file, "r+b");
+    FILE *index = predictions != NULL ? fopen(path, "r+b") : NULL;
+    PredictionIndexHeader header;
+    int ok = index != NULL && readPredictionIndexHeader(index, predictions, &header);
+
+    for (int i = 0; ok && i < pendingChangeCount; i++)
+    {
+        ForecastData old;
+        PredictionIndexEntry entry;
+        unsigned int bucket;
+        char row[MAX_ROW_LENGTH];
+        int length = 0;
+
+        int found = probePredictionIndex(index, &header, predictions, pendingChanges[i], &old, &bucket);
+        if (found < 0 || !readPredictionIndexEntry(index, bucket, &entry))
+        {
+            ok = 0;
+            break;
+        }
+        long long oldOffset = entry.offset - 1;
+        long long oldLength = found ? rowLength(predictions, oldOffset) : 0;
+
+        int slot = findLocation(pendingChanges[i]);
+        if (slot != -1)
+        {
+            length = formatPredictionRow(row, sizeof(row), slot);
+            if (length <= 0 || length >= (int)sizeof(row))
+            {
+                ok = 0;
+                break;
+            }
+        }
+
+        if (found && slot != -1 && length <= oldLength)
+        {
+            // The new row fits: rewrite it in place, padded with spaces before the newline
+            memset(row + length - 1, ' ', (size_t)(oldLength - length));
+            row[oldLength - 1] = '\n';
+            fseek(predictions, (long)oldOffset, SEEK_SET);
+            fwrite(row, 1, (size_t)oldLength, predictions);
+            continue;
+        }
+
+        if (found)
+        {
+            blankRow(predictions, oldOffset, oldLength);
+            header.deadBytes += oldLength;
+        }
+
+        if (slot == -1)
+        {
+            if (found)
+            {
+                // Deleted station: leave a tombstone so later probe chains stay intact
+                entry.hash = 0;
+                entry.offset = -1;
+                header.entries--;
+                header.tombstones++;
+            }
+            else
+            {
+                continue; // never had a row
+            }
+        }
+        else
+        {
+            // New or grown row: append it and point the bucket at the new offset
+            fseek(predictions, 0, SEEK_END);
+            long long offset = ftell(predictions);
+            fwrite(row, 1, (size_t)length, predictions);
+
+            if (!found)
+            {
+                header.entries++;
+                if (entry.offset == -1)
+                {
+                    header.tombstones--; // the insert reuses the bucket of a deleted row
+                }
+            }
+            entry.hash = hashLocation(stations.location[slot]);
+            entry.reserved = 0;
+            entry.offset = offset + 1;
+        }
+
+        fseek(index, (long)(sizeof(PredictionIndexHeader) + (size_t)bucket * sizeof(PredictionIndexEntry)), SEEK_SET);
+        ok = fwrite(&entry, sizeof(entry), 1, index) == 1;
+        if (2 * (header.entries + header.tombstones) > header.capacity)
+        {
+            ok = 0; // probe chains are getting long, rebuild instead
+        }
+    }
+
+    if (ok)
+    {
+        fflush(predictions);
+        header.predictionsSize = fileSize(predictions);
+        if (2 * header.deadBytes > header.predictionsSize)
+        {
+            ok = 0; // more blank rows than live ones, rebuild instead
+        }
+    }
+    if (ok)
+    {
+        rewind(index);
+        ok = fwrite(&header, sizeof(header), 1, index) == 1;
+    }
+
+    if (index != NULL)
+    {
+        fclose(index);
+    }
+    if (predictions != NULL)
+    {
+        fclose(predictions);
+    }
+    return ok;
+}
+
+// Function to bring the predictions up to date after an admin edit.
+// Only the stations reported by the storage layer are recomputed; a full
+// update_predictions is the fallback when the rows can't be patched.
+void patch_predictions(const char *input_file, const char *output_file)
+{
+    if (pendingChangeCount == 0 && !pendingChangesOverflowed)
+    {
+        return; // nothing changed
+    }
+
+    if (pendingChangesOverflowed || !patchPredictionRows(output_file))
+    {
+        // data.txt only catches up with the log on compaction, so compact before the full rebuild
+        compactStationLog(1);
+        update_predictions(input_file, output_file);
+        computeWaterLevels(0, count); // the rebuild only wrote the file
+    }
+
+    pendingChangeCount = 0;
+    pendingChangesOverflowed = 0;
+}
+
+//////////////////////////// END ///////////////////////////////////////
+
+////////////////// DATA ASSIMILATION //////////////////////
+/*
+assimilateGaugeReadings brings every station's gauge filter up to its newest
+reading in gauges.txt. Like calibration, each new reading is paired with the
+station's newest history observation at most CALIBRATION_MAX_GAP older, and
+the station's current model gives the level it predicted then (in parallel
+per station on the thread pool). The readings are then assimilated in rounds:
+round r takes the r-th new reading of every station, with the stations sorted
+by how many they have, so each round is one kernel pass over a prefix of the
+lanes and the whole network is through after as many passes as the busiest
+station has new readings.
+
+After each assimilation the filter state goes to data_base/gauge_filter.txt
+with the number of bytes of gauges.txt it covers, so a restart or a new
+reading only reads the lines past that offset. A calibration clears the
+filter and starts again from the first line, as does a gauges.txt shorter
+than the offset.
+*/
+
+// one gauge reading waiting to be assimilated
+typedef struct
+{
+    int row;      // filter row of its station
+    int sequence; // line in gauges.txt, keeps readings of the same time in order
+    long long time;
+    double observed;
+    double predicted; // model level at the reading
+    float rainfall;   // observation it was paired with
+    float temperature;
+    int paired;
+} PendingReading;
+
+// new readings of an assimilation, grouped by station and in time order within a station
+typedef struct
+{
+    PendingReading *readings;
+    int count;
+    int capacity;
+    int *start; // first reading of each station, groups + 1 entries
+    int groups;
+    long long end; // bytes of gauges.txt read, up to the end of the last whole line
+} AssimilationJob;
+
+// pairing of one station's readings with its history as scanHistory streams it
+typedef struct
+{
+    PendingReading *readings;
+    int count;
+    int next;
+    Observation previous;
+    int seen;
+} ReadingPairing;
+
+// station of an assimilation and how many new readings it has
+typedef struct
+{
+    int group;
+    int readings;
+} AssimilationLane;
+
+// Function to compare pending readings by station and time for qsort
+int comparePendingReadings(const void *a, const void *b)
+{
+    const PendingReading *x = a, *y = b;
+    if (x->row != y->row)
+    {
+        return x->row < y->row ? -1 : 1;
+    }
+    if (x->time != y->time)
+    {
+        return x->time < y->time ? -1 : 1;
+    }
+    return (x->sequence > y->sequence) - (x->sequence < y->sequence);
+}
 
-    // Copy existing data into the current array (if needed for other operations)
-    for (int i = 0; i < existingCount; i++)
+// Function to order assimilation lanes by readings, most first, for qsort
+int compareAssimilationLanes(const void *a, const void *b)
+{
+    const AssimilationLane *x = a, *y = b;
+    if (x->readings != y->readings)
     {
-        data[i] = existingData[i];
+        return x->readings > y->readings ? -1 : 1;
     }
-    count = existingCount;
+    return (x->group > y->group) - (x->group < y->group);
+}
 
-    // Get location input from user
-    printf("\033[1;34m"); // Blue color for prompt
-    printf("Enter the location name to update: ");
-    printf("\033[0m"); // Reset color
+// Function to pair the next reading with the newest observation streamed so far
+void pairPendingReading(ReadingPairing *pairing)
+{
+    PendingReading *reading = &pairing->readings[pairing->next++];
+    if (pairing->seen && reading->time - pairing->previous.time <= CALIBRATION_MAX_GAP)
+    {
+        reading->rainfall = pairing->previous.rainfall;
+        reading->temperature = pairing->previous.temperature;
+        reading->paired = 1;
+    }
+}
+
+// Function to pair the readings older than an observation before moving past it (a scanHistory visitor)
+void pairReadingsBefore(const Observation *point, void *arg)
+{
+    ReadingPairing *pairing = arg;
+    while (pairing->next < pairing->count && pairing->readings[pairing->next].time < point->time)
+    {
+        pairPendingReading(pairing);
+    }
+    pairing->previous = *point;
+    pairing->seen = 1;
+}
+
+// Function to compute the model level at each new reading of one station (a thread pool task)
+void predictReadingsTask(int task, void *arg)
+{
+    AssimilationJob *job = arg;
+    PendingReading *readings = job->readings + job->start[task];
+    int count = job->start[task + 1] - job->start[task];
+    const char *location = gaugeFilter.location[readings[0].row];
+
+    ReadingPairing pairing = {readings, count, 0, {0, 0, 0}, 0};
+    scanHistory(location, readings[0].time - CALIBRATION_MAX_GAP, readings[count - 1].time, pairReadingsBefore, &pairing);
+    while (pairing.next < count)
+    {
+        pairPendingReading(&pairing);
+    }
+
+    int parameters = findStationParameters(location), curve = findRatingCurve(location), alert;
+    for (int i = 0; i < count; i++)
+    {
+        if (readings[i].paired)
+        {
+            readings[i].predicted = station_water_level(parameters, curve, location, readings[i].rainfall, readings[i].temperature, readings[i].time, &alert);
+        }
+    }
+}
+
+// Function to read the gauge readings past the assimilated part of gauges.txt and newer than their
+// station's filter state into job
+int loadPendingReadings(AssimilationJob *job)
+{
+    LineReader reader;
+    job->end = gaugeFilter.offset;
+    if (!openLineReader(&reader, gauge_file))
+    {
+        return 0; // no readings yet
+    }
+    long long size, stamp;
+    fileStamp(gauge_file, &size, &stamp);
+    if (size < gaugeFilter.offset)
+    {
+        clearGaugeFilter(); // gauges.txt was rewritten: start over from its first reading
+        job->end = 0;
+    }
+    fseek(reader.file, (long)job->end, SEEK_SET);
+
+    const char *line;
+    size_t length;
+    int sequence = 0;
+    while (nextLine(&reader, &line, &length))
+    {
+        TextField fields[3];
+        char location[MAX_LOCATION_LENGTH], text[32], *end;
+        float level;
+        sequence++;
+        long long consumed = line + length < reader.data + reader.size ? (long long)length + 1 : 0; // a last line still being written is read again
+        job->end += consumed;
+        if (splitFields(line, length, fields, 3) != 3 || !copyField(&fields[0], location, sizeof(location)) ||
+            !copyField(&fields[1], text, sizeof(text)) || !parseFloatField(&fields[2], &level))
+        {
+            continue; // malformed line
+        }
+        long long time = strtoll(text, &end, 10);
+        if (*end != '\0' || time <= 0 || findHistorySeries(location, 0) == NULL)
+        {
+            continue; // nothing to pair it with
+        }
+        int row = findFilterRow(location, 1);
+        if (row == -1 || time <= gaugeFilter.time[row])
+        {
+            continue; // already assimilated
+        }
+
+        if (job->count == job->capacity)
+        {
+            int capacity = job->capacity ? job->capacity * 2 : 256;
+            if (!growColumn((void **)&job->readings, sizeof(PendingReading), capacity))
+            {
+                job->end -= consumed; // out of memory: the rest waits for the next reading
+                break;
+            }
+            job->capacity = capacity;
+        }
+        PendingReading *reading = &job->readings[job->count++];
+        memset(reading, 0, sizeof(*reading));
+        reading->row = row;
+        reading->sequence = sequence;
+        reading->time = time;
+        reading->observed = level;
+    }
+    closeLineReader(&reader);
+    return job->count;
+}
+
+// Function to assimilate every gauge reading newer than its station's filter state, returns how many were
+int assimilateGaugeReadings()
+{
+    AssimilationJob job = {NULL, 0, 0, NULL, 0, 0};
+    long long offset = gaugeFilter.offset;
+    if (loadPendingReadings(&job) == 0)
+    {
+        free(job.readings);
+        if (job.end != offset)
+        {
+            gaugeFilter.offset = job.end; // lines with nothing to assimilate aren't read again either
+            saveGaugeFilter();
+        }
+        return 0;
+    }
+
+    // group the readings by station, in time order, and find the model level at each
+    qsort(job.readings, job.count, sizeof(PendingReading), comparePendingReadings);
+    job.start = malloc((job.count + 1) * sizeof(int));
+    if (job.start == NULL)
+    {
+        free(job.readings);
+        return 0;
+    }
+    for (int i = 0; i < job.count; i++)
+    {
+        if (i == 0 || job.readings[i].row != job.readings[i - 1].row)
+        {
+            job.start[job.groups++] = i;
+        }
+    }
+    job.start[job.groups] = job.count;
+    runParallel(job.groups, predictReadingsTask, &job);
+
+    // readings without an observation to pair with are left out
+    int kept = 0, groups = 0;
+    for (int g = 0; g < job.groups; g++)
+    {
+        int first = kept;
+        for (int i = job.start[g]; i < job.start[g + 1]; i++)
+        {
+            if (job.readings[i].paired)
+            {
+                job.readings[kept++] = job.readings[i];
+            }
+        }
+        if (kept > first)
+        {
+            job.start[groups++] = first;
+        }
+    }
+    job.start[groups] = kept;
+    job.groups = groups;
+
+    AssimilationLane *lanes = malloc((groups ? groups : 1) * sizeof(AssimilationLane));
+    double *columns = malloc((size_t)(groups ? groups : 1) * 9 * sizeof(double));
+    long long *lastTime = malloc((groups ? groups : 1) * sizeof(long long));
+    if (lanes == NULL || columns == NULL || lastTime == NULL)
+    {
+        kept = 0;
+        groups = 0;
+    }
+    for (int g = 0; g < groups; g++)
+    {
+        lanes[g].group = g;
+        lanes[g].readings = job.start[g + 1] - job.start[g];
+    }
+    qsort(lanes, groups, sizeof(AssimilationLane), compareAssimilationLanes);
+
+    // gather the filter states into lane order, one round per reading of the busiest station
+    double *observed = columns + 5 * (size_t)groups, *predicted = columns + 6 * (size_t)groups;
+    double *decay = columns + 7 * (size_t)groups, *hours = columns + 8 * (size_t)groups;
+    KalmanBatch batch = {columns, columns + groups, columns + 2 * (size_t)groups, columns + 3 * (size_t)groups,
+                         columns + 4 * (size_t)groups, observed, predicted, decay, hours};
+    for (int j = 0; j < groups; j++)
+    {
+        int row = job.readings[job.start[lanes[j].group]].row;
+        batch.error[j] = gaugeFilter.error[row];
+        batch.bias[j] = gaugeFilter.bias[row];
+        batch.p00[j] = gaugeFilter.p00[row];
+        batch.p01[j] = gaugeFilter.p01[row];
+        batch.p11[j] = gaugeFilter.p11[row];
+        lastTime[j] = gaugeFilter.time[row];
+    }
+    int active = groups;
+    for (int round = 0; active > 0; round++)
+    {
+        while (active > 0 && lanes[active - 1].readings <= round)
+        {
+            active--;
+        }
+        for (int j = 0; j < active; j++)
+        {
+            const PendingReading *reading = &job.readings[job.start[lanes[j].group] + round];
+            hours[j] = lastTime[j] != 0 ? (reading->time - lastTime[j]) / 3600.0 : 0;
+            decay[j] = exp(-hours[j] / KALMAN_ERROR_HOURS);
+            observed[j] = reading->observed;
+            predicted[j] = reading->predicted;
+            lastTime[j] = reading->time;
+        }
+        kalman_update_batch(&batch, 0, active);
+    }
+    for (int j = 0; j < groups; j++)
+    {
+        int row = job.readings[job.start[lanes[j].group]].row;
+        gaugeFilter.error[row] = batch.error[j];
+        gaugeFilter.bias[row] = batch.bias[j];
+        gaugeFilter.p00[row] = batch.p00[j];
+        gaugeFilter.p01[row] = batch.p01[j];
+        gaugeFilter.p11[row] = batch.p11[j];
+        gaugeFilter.time[row] = lastTime[j];
+    }
+    if (lanes != NULL && columns != NULL && lastTime != NULL)
+    {
+        gaugeFilter.offset = job.end;
+        saveGaugeFilter();
+    }
+
+    free(lanes);
+    free(columns);
+    free(lastTime);
+    free(job.start);
+    free(job.readings);
+    return kept;
+}
+
+///////////////////////// END /////////////////////////////
+
+////////////////// MODEL CALIBRATION //////////////////////
+/*
+Admins record observed (gauge) water levels in data_base/gauges.txt:
+    <location> <time> <level>
+Calibration pairs every gauge reading with the station's newest history
+observation at most CALIBRATION_MAX_GAP seconds older, and fits the station's
+ALPHA, BETA and GAMMA by least squares:
+    level / factor = alpha * rainfall + beta * temperature + gamma
+(rainfall being the hydrograph's runoff for the reading's hour at stations
+with a unit hydrograph, and level / factor the units the rating curve turns
+into that level at stations with one).
+The factor and threshold stay as they are. Stations are fitted in parallel on
+the thread pool; each accumulates its 3x3 normal equations four samples at a
+time in independent lanes (which the compiler turns into vector adds) and
+sums the lanes in a fixed order, so the fit is the same on any thread count.
+*/
+
+// one gauge reading
+typedef struct
+{
+    long long time;
+    float level;
+} GaugeReading;
+
+// the gauge readings of one history series and what calibration made of them
+typedef struct
+{
+    GaugeReading *readings;
+    int count;
+    int capacity;
+    int samples; // readings paired with an observation
+    int fitted;
+    double alpha;
+    double beta;
+    double gamma;
+    double rmsError; // of the fitted levels, in meters
+} CalibrationStation;
+
+// calibration of every series that has gauge readings, indexed like historySeries
+typedef struct
+{
+    CalibrationStation *stations;
+    int count;
+    int *order;  // series with readings
+    int tasks;
+} CalibrationJob;
+
+// Function to append an observed water level of a station to gauges.txt
+int recordGaugeReading(const char *location, long long time, float level)
+{
+    FILE *file = fopen(gauge_file, "a");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    int ok = fprintf(file, "%s %lld %.2f\n", location, time, level) > 0;
+    syncFile(file);
+    fclose(file);
+    return ok;
+}
+
+// Function to compare gauge readings by time for qsort
+int compareGaugeReadings(const void *a, const void *b)
+{
+    long long left = ((const GaugeReading *)a)->time, right = ((const GaugeReading *)b)->time;
+    return (left > right) - (left < right);
+}
+
+// Function to read gauges.txt into per-series reading lists (readings of locations without history are skipped)
+int loadGaugeReadings(CalibrationJob *job)
+{
+    memset(job, 0, sizeof(*job));
+    job->count = historySeriesCount;
+    job->stations = calloc(job->count ? job->count : 1, sizeof(CalibrationStation));
+    job->order = malloc((job->count ? job->count : 1) * sizeof(int));
+    if (job->stations == NULL || job->order == NULL)
+    {
+        return 0;
+    }
+
+    LineReader reader;
+    if (!openLineReader(&reader, gauge_file))
+    {
+        return 1; // no readings yet
+    }
+    const char *line;
+    size_t length;
+    while (nextLine(&reader, &line, &length))
+    {
+        TextField fields[3];
+        char location[MAX_LOCATION_LENGTH], text[32], *end;
+        float level;
+        if (splitFields(line, length, fields, 3) != 3 || !copyField(&fields[0], location, sizeof(location)) ||
+            !copyField(&fields[1], text, sizeof(text)) || !parseFloatField(&fields[2], &level))
+        {
+            continue; // malformed line
+        }
+        long long time = strtoll(text, &end, 10);
+        HistorySeries *series = findHistorySeries(location, 0);
+        if (*end != '\0' || series == NULL)
+        {
+            continue;
+        }
+
+        CalibrationStation *station = &job->stations[series - historySeries];
+        if (station->count == station->capacity)
+        {
+            int capacity = station->capacity ? station->capacity * 2 : 64;
+            if (!growColumn((void **)&station->readings, sizeof(GaugeReading), capacity))
+            {
+                break;
+            }
+            station->capacity = capacity;
+        }
+        station->readings[station->count].time = time;
+        station->readings[station->count].level = level;
+        station->count++;
+    }
+    closeLineReader(&reader);
+
+    for (int s = 0; s < job->count; s++)
+    {
+        if (job->stations[s].count > 0)
+        {
+            job->order[job->tasks++] = s;
+        }
+    }
+    return 1;
+}
+
+// history points of one station, gathered for pairing
+typedef struct
+{
+    long long *time;
+    float *rainfall;
+    float *temperature;
+    int count;
+    int capacity;
+} ObservationColumns;
+
+// Function to append a scanned observation to ObservationColumns
+void collectObservation(const Observation *point, void *arg)
+{
+    ObservationColumns *columns = arg;
+    if (columns->count == columns->capacity)
+    {
+        int capacity = columns->capacity ? columns->capacity * 2 : 1024;
+        if (!growColumn((void **)&columns->time, sizeof(long long), capacity) ||
+            !growColumn((void **)&columns->rainfall, sizeof(float), capacity) ||
+            !growColumn((void **)&columns->temperature, sizeof(float), capacity))
+        {
+            return; // the point is dropped, the fit uses fewer samples
+        }
+        columns->capacity = capacity;
+    }
+    columns->time[columns->count] = point->time;
+    columns->rainfall[columns->count] = point->rainfall;
+    columns->temperature[columns->count] = point->temperature;
+    columns->count++;
+}
+
+// Function to accumulate the normal-equation sums of y = alpha * r + beta * t + gamma:
+// n, r, t, r*r, r*t, t*t, y, r*y, t*y
+void accumulateNormalEquations(const float *r, const float *t, const float *y, int n, double sums[9])
+{
+    double lanes[9][4] = {{0}};
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        for (int l = 0; l < 4; l++)
+        {
+            double rl = r[i + l], tl = t[i + l], yl = y[i + l];
+            lanes[0][l] += 1;
+            lanes[1][l] += rl;
+            lanes[2][l] += tl;
+            lanes[3][l] += rl * rl;
+            lanes[4][l] += rl * tl;
+            lanes[5][l] += tl * tl;
+            lanes[6][l] += yl;
+            lanes[7][l] += rl * yl;
+            lanes[8][l] += tl * yl;
+        }
+    }
+    for (int l = 0; i < n; i++, l++)
+    {
+        double rl = r[i], tl = t[i], yl = y[i];
+        lanes[0][l] += 1;
+        lanes[1][l] += rl;
+        lanes[2][l] += tl;
+        lanes[3][l] += rl * rl;
+        lanes[4][l] += rl * tl;
+        lanes[5][l] += tl * tl;
+        lanes[6][l] += yl;
+        lanes[7][l] += rl * yl;
+        lanes[8][l] += tl * yl;
+    }
+    for (int k = 0; k < 9; k++)
+    {
+        sums[k] = (lanes[k][0] + lanes[k][1]) + (lanes[k][2] + lanes[k][3]);
+    }
+}
+
+// Function to solve the 3x3 system a * x = b by Gaussian elimination with partial pivoting.
+// Returns 0 when it is (nearly) singular, e.g. a station whose temperature never changed.
+int solve3x3(double a[3][3], double b[3], double x[3])
+{
+    for (int col = 0; col < 3; col++)
+    {
+        int pivot = col;
+        for (int row = col + 1; row < 3; row++)
+        {
+            if (fabs(a[row][col]) > fabs(a[pivot][col]))
+            {
+                pivot = row;
+            }
+        }
+        if (fabs(a[pivot][col]) < 1e-9 * (fabs(a[0][0]) + fabs(a[1][1]) + fabs(a[2][2])))
+        {
+            return 0;
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            double swap = a[col][k];
+            a[col][k] = a[pivot][k];
+            a[pivot][k] = swap;
+        }
+        double swap = b[col];
+        b[col] = b[pivot];
+        b[pivot] = swap;
+
+        for (int row = col + 1; row < 3; row++)
+        {
+            double scale = a[row][col] / a[col][col];
+            for (int k = col; k < 3; k++)
+            {
+                a[row][k] -= scale * a[col][k];
+            }
+            b[row] -= scale * b[col];
+        }
+    }
+    for (int row = 2; row >= 0; row--)
+    {
+        double sum = b[row];
+        for (int k = row + 1; k < 3; k++)
+        {
+            sum -= a[row][k] * x[k];
+        }
+        x[row] = sum / a[row][row];
+    }
+    return 1;
+}
+
+// Function to fit one station (a thread pool task)
+void calibrateStationTask(int task, void *arg)
+{
+    CalibrationJob *job = arg;
+    int s = job->order[task];
+    CalibrationStation *station = &job->stations[s];
+    const char *location = historySeries[s].location;
+
+    qsort(station->readings, station->count, sizeof(GaugeReading), compareGaugeReadings);
+    ObservationColumns history = {NULL, NULL, NULL, 0, 0};
+    scanHistory(location, station->readings[0].time - CALIBRATION_MAX_GAP, station->readings[station->count - 1].time, collectObservation, &history);
+
+    double parameters[MODEL_PARAMETERS];
+    getStationParameters(location, parameters);
+    int curve = findRatingCurve(location);
+
+    // With a unit hydrograph the fit is against the runoff of each reading's hour
+    const HistorySeries *delayed = stationHydrograph(location);
+    long long firstHour = station->readings[0].time / 3600;
+    int hours = (int)(station->readings[station->count - 1].time / 3600 - firstHour + 1);
+    float *runoff = delayed != NULL ? malloc(hours * sizeof(float)) : NULL;
+    if (runoff != NULL && !hydrographRunoff(delayed, firstHour, hours, runoff))
+    {
+        free(runoff);
+        runoff = NULL;
+    }
+
+    // Pair each reading with the newest observation at or before it (both lists are in time order)
+    float *r = malloc(station->count * sizeof(float));
+    float *t = malloc(station->count * sizeof(float));
+    float *y = malloc(station->count * sizeof(float));
+    int samples = 0;
+    for (int i = 0, next = 0; i < station->count && r != NULL && t != NULL && y != NULL && (delayed == NULL || runoff != NULL); i++)
+    {
+        while (next < history.count && history.time[next] <= station->readings[i].time)
+        {
+            next++;
+        }
+        if (next > 0 && station->readings[i].time - history.time[next - 1] <= CALIBRATION_MAX_GAP)
+        {
+            r[samples] = runoff != NULL ? runoff[station->readings[i].time / 3600 - firstHour] : history.rainfall[next - 1];
+            t[samples] = history.temperature[next - 1];
+            y[samples] = (float)(curve >= 0 ? ratingUnits(curve, station->readings[i].level) : station->readings[i].level / parameters[PARAM_FACTOR]);
+            samples++;
+        }
+    }
+    station->samples = samples;
+
+    double sums[9];
+    accumulateNormalEquations(r, t, y, samples, sums);
+    double a[3][3] = {{sums[3], sums[4], sums[1]}, {sums[4], sums[5], sums[2]}, {sums[1], sums[2], sums[0]}};
+    double b[3] = {sums[7], sums[8], sums[6]}, x[3];
+    if (samples >= CALIBRATION_MIN_SAMPLES && solve3x3(a, b, x))
+    {
+        station->fitted = 1;
+        station->alpha = x[0];
+        station->beta = x[1];
+        station->gamma = x[2];
+
+        double squares = 0;
+        for (int i = 0; i < samples; i++)
+        {
+            double fit = x[0] * r[i] + x[1] * t[i] + x[2];
+            double error = curve >= 0 ? ratingStage(curve, (float)fit) - ratingStage(curve, y[i]) : (fit - y[i]) * parameters[PARAM_FACTOR];
+            squares += error * error;
+        }
+        station->rmsError = sqrt(squares / samples);
+    }
+
+    free(runoff);
+    free(r);
+    free(t);
+    free(y);
+    free(history.time);
+    free(history.rainfall);
+    free(history.temperature);
+}
+
+// Function to fit every station with gauge readings, returns how many were fitted
+int fitStationModels(CalibrationJob *job)
+{
+    if (!loadGaugeReadings(job))
+    {
+        return 0;
+    }
+    runParallel(job->tasks, calibrateStationTask, job);
+
+    int fitted = 0;
+    for (int i = 0; i < job->tasks; i++)
+    {
+        fitted += job->stations[job->order[i]].fitted;
+    }
+    return fitted;
+}
+
+// Function to store the fitted coefficients in params.txt and rebuild the predictions with them
+int applyStationModels(const CalibrationJob *job)
+{
+    for (int i = 0; i < job->tasks; i++)
+    {
+        const CalibrationStation *station = &job->stations[job->order[i]];
+        if (station->fitted)
+        {
+            double parameters[MODEL_PARAMETERS];
+            getStationParameters(historySeries[job->order[i]].location, parameters);
+            parameters[PARAM_ALPHA] = station->alpha;
+            parameters[PARAM_BETA] = station->beta;
+            parameters[PARAM_GAMMA] = station->gamma;
+            setStationParameters(historySeries[job->order[i]].location, parameters);
+        }
+    }
+    if (!saveStationParameters())
+    {
+        return 0;
+    }
 
+    compactStationLog(1); // data.txt has to be current for the rebuild
+    update_predictions(input_file, prediction_file);
+    computeWaterLevels(0, count);
+    clearGaugeFilter(); // the corrections were of the old model
+    assimilateGaugeReadings();
+    return 1;
+}
+
+// Function to free a calibration job
+void freeCalibrationJob(CalibrationJob *job)
+{
+    for (int s = 0; s < job->count; s++)
+    {
+        free(job->stations[s].readings);
+    }
+    free(job->stations);
+    free(job->order);
+    memset(job, 0, sizeof(*job));
+}
+
+// Function to let an admin enter an observed water level for a station
+void recordObservedLevel()
+{
+    char location[MAX_LOCATION_LENGTH];
+    float level;
+
+    printf("\033[1;34m"); // Blue for input prompts
+    printf("Enter location: ");
+    printf("\033[0m");
+    printf("\033[1;33m");
+    scanf("%49s", location);
+    printf("\033[0m");
+
+    int slot = findLocation(location);
+    if (slot == -1)
+    {
+        printf("\033[1;31m"); // Red for error
+        printf("Location '%s' not found.\n", location);
+        printf("\033[0m");
+        return;
+    }
+
+    printf("\033[1;34m");
+    printf("Enter observed water level (in meters): ");
+    printf("\033[0m");
     printf("\033[1;33m");
-    scanf("%s", newLocation);
+    scanf("%f", &level);
+    printf("\033[0m");
+
+    if (!recordGaugeReading(stations.location[slot], (long long)time(NULL), level))
+    {
+        printf("\033[1;31m"); // Red for error
+        printf("Error saving data.\n");
+        printf("\033[0m");
+        return;
+    }
+    printf("\033[1;32m"); // Green for success
+    printf("Observed water level saved for %s.\n", stations.location[slot]);
+    if (assimilateGaugeReadings() > 0)
+    {
+        printf("Model level now corrected by %+.2f m.\n", gaugeCorrection(stations.location[slot], (long long)time(NULL)));
+    }
     printf("\033[0m");
+}
 
+// Function to calibrate the model from the recorded history and show the fitted coefficients
+void calibrateModel()
+{
+    CalibrationJob job;
+    loadingDotsAnimation(1, "Fitting");
     clearScreen();
-    loadingDotsAnimation(2, "Searching");
-    // Check if location already exists in the loaded data (case-insensitive)
-    for (int i = 0; i < existingCount; i++)
+
+    int fitted = fitStationModels(&job);
+    printf("\033[1;34m"); // Blue for header text
+    printf("%-15s %-10s %-12s %-12s %-12s %-10s\n", "Area", "Samples", "Alpha", "Beta", "Gamma", "RMS(M)");
+    printf("--------------------------------------------------------------------------\n");
+    printf("\033[0m");
+    for (int i = 0; i < job.tasks; i++)
     {
-        if (compareLocations(existingData[i].location, newLocation) == 0)
+        const CalibrationStation *station = &job.stations[job.order[i]];
+        if (station->fitted)
         {
-            foundIndex = i;
-            break;
+            printf("\033[1;32m"); // Green for fitted stations
+            printf("%-15s %-10d %-12.4f %-12.4f %-12.4f %-10.3f\n", historySeries[job.order[i]].location, station->samples,
+                   station->alpha, station->beta, station->gamma, station->rmsError);
+        }
+        else
+        {
+            printf("\033[1;31m"); // Red for stations left on their coefficients
+            printf("%-15s %-10d not enough varied samples\n", historySeries[job.order[i]].location, station->samples);
         }
+        printf("\033[0m");
     }
 
-    if (foundIndex != -1)
+    if (fitted == 0)
     {
-        // Update the existing data for the found location
-        clearScreen();
-        printf("\033[1;32m"); // Green for success
-        printf("Updating Data for %s.\n\n", data[foundIndex].location);
-        printf("\033[0m"); // Reset color
-        printf("\033[1;34m");
-        printf("Enter new rainfall (in mm): ");
-        printf("\033[0m");
         printf("\033[1;33m");
-        scanf("%f", &data[foundIndex].rainfall);
-        printf("\033[1;0m");
-        printf("\033[1;34m");
-        printf("Enter new temperature (in degrees celsius): ");
+        printf("\nNo station could be calibrated; record observed water levels first.\n");
         printf("\033[0m");
-        printf("\033[1;33m");
-        scanf("%f", &data[foundIndex].temperature);
+    }
+    else if (applyStationModels(&job))
+    {
+        printf("\033[1;32m");
+        printf("\n%d station(s) calibrated, predictions updated.\n", fitted);
         printf("\033[0m");
-
-        clearScreen();
-        printf("\033[1;32m"); // Green for success
-        loadingDotsAnimation(2,"Updating");
-        printf("\033[0m"); // Reset color
-
-        clearScreen();
-
-        printf("\033[1;32m"); // Green for success
-        printf("Data Updated Successfully for %s.\n", data[foundIndex].location);
-        printf("\033[0m"); // Reset color
-
-        // Open the file for writing (this will overwrite the existing file)
-        FILE *file = fopen("data_base/data.txt", "w");
-        if (file == NULL)
-        {
-            printf("\033[1;31m"); // Red for error
-            printf("Error opening file for writing.\n");
-            printf("\033[0m"); // Reset color
-            return;
-        }
-
-        // Write all data back to the file after updating
-        for (int i = 0; i < count; i++)
-        {
-            fprintf(file, "%s %.2f %.2f\n", data[i].location, data[i].rainfall, data[i].temperature);
-        }
-
-        fclose(file);
-        //printf("\033[1;32m"); // Green for success
-        //printf("Data saved successfully to the file.\n");
-        //printf("\033[0m"); // Reset color
     }
     else
     {
-        clearScreen();
-        printf("\033[1;31m"); // Red for error
-        printf("Location '%s' not found in the data.\n", newLocation);
-        printf("\033[0m"); // Reset color
+        printf("\033[1;31m");
+        printf("\nError saving the calibrated coefficients.\n");
+        printf("\033[0m");
     }
+    freeCalibrationJob(&job);
 }
 
-//////////////////////////// END ///////////////////////////
+///////////////////////// END /////////////////////////////
 
-///////////////// SHOW FORCAST TO USER LOCATION /////////////////
+//////////////// DISPLAY ALERT FOR ADMIN ///////////////////////////////////////
 
-void showForecast(const char *location)
+// Function to display the alert table from the prediction file
+void view_alert(const char *prediction_file)
 {
-    FILE *file = fopen("data_base/predictions.txt", "r");
-    if (file == NULL)
+    LineReader reader;
+    if (!openMappedLineReader(&reader, prediction_file))
     {
         printf("\033[1;31m"); // Red for error message
-        printf("Error opening predictions file.\n");
+        printf("Error: Could not open prediction file.\n");
         printf("\033[0m"); // Reset color
         return;
     }
 
-    ForecastData data;
-    int found = 0;
+    ForecastData row;
+    const char *line;
+    size_t length;
+    long long now = (long long)time(NULL);
+
+    // Print the table header
+    printf("\033[1;34m"); // Blue for header text
+    printf("%-15s %-15s %-15s %-10s %-10s %-10s %-25s %-10s\n", "Area", "Rainfall(mm)", "Temperature(C)", "24h(mm)", "72h(mm)", "7d(mm)", "Predicted Water Level(M)", "Alert");
+    printf("-----------------------------------------------------------------------------------------------------------------\n");
+    printf("\033[0m"); // Reset color
 
-    //clearScreen();
-    // Read each line of the file and search for the location
-    while (fscanf(file, "%s %f %f %f %s", data.location, &data.rainfall, &data.temperature, &data.waterLevel, data.alertStatus) != EOF)
+    // Reading each line from the prediction file (blanked and malformed rows are skipped)
+    int corrected = 0;
+    while (nextLine(&reader, &line, &length))
     {
-        if (strcasecmp(data.location, location) == 0)
-        { // Case-insensitive comparison
-            //clearScreen();
-            found = 1;
+        if (!parsePredictionLine(line, length, &row))
+        {
+            continue;
+        }
 
-            
+        // Stations with observed gauge levels show the corrected level and its alert
+        float correction = gaugeCorrection(row.location, now);
+        if (correction != 0)
+        {
+            double parameters[MODEL_PARAMETERS];
+            getStationParameters(row.location, parameters);
+            row.waterLevel += correction;
+            strcpy(row.alertStatus, row.waterLevel > parameters[PARAM_THRESHOLD] ? "ON" : "OFF");
+            corrected++;
+        }
 
-            //printf("\033[1;32m"); // Green for showing the forecast
-            //printf("Displaying forecast for your location...\n");
-            //printf("\033[0m");
+        // Color code the alert status (Green for safe, Red for alert)
+        if (strcmp(row.alertStatus, "OFF") == 0)
+        {
+            printf("\033[1;32m"); // Green for safe
+        }
+        else if (strcmp(row.alertStatus, "ON") == 0)
+        {
+            printf("\033[1;31m"); // Red for alert
+        }
 
-            // Forecast section with green for location name and blue for other details
-            printf("\033[1;32m"); // Green for location name
-            printf("Location: %s\n", data.location);
-            printf("\033[1;34m"); // Blue for other data
-            printf("Temperature: %.2f°C\n", data.temperature);
-            printf("Rainfall: %.2f mm\n", data.rainfall);
-            printf("Water Level: %.2f m\n", data.waterLevel);
+        // Print the formatted data row with the rainfall accumulated up to now
+        float accumulated[RAIN_WINDOWS];
+        rollingRainfall(row.location, now, accumulated);
+        printf("%-15s %-15.2f %-15.2f %-10.2f %-10.2f %-10.2f %-25.2f %-10s\n", row.location, row.rainfall, row.temperature,
+               accumulated[0], accumulated[1], accumulated[2], row.waterLevel, row.alertStatus);
 
-            // Color change for alert status: red for "ON", green for "OFF"
-            if (strcasecmp(data.alertStatus, "ON") == 0)
-            {
-                printf("\033[1;31m"); // Red for alert ON
-            }
-            else
-            {
-                printf("\033[1;32m"); // Green for alert OFF
-            }
-            printf("Alert: %s\n", data.alertStatus);
-            printf("\033[0m"); // Reset color
-            break;
-        }
+        printf("\033[0m"); // Reset color after each row
     }
-
-    if (!found)
+    if (corrected > 0)
     {
-        // If location not found, show error in red
-        printf("\033[1;31m"); // Red for error message
-        printf("Location '%s' not found in the forecast data.\n", location);
-        printf("\033[0m"); // Reset color
+        printf("\033[1;34m");
+        printf("%d water levels corrected by observed gauge levels.\n", corrected);
+        printf("\033[0m");
     }
 
-    fclose(file);
+    closeLineReader(&reader);
 }
 
-//////////////////// SHOW FORCAST TO SEARCH LOCATION //////////////
-void searchOtherLocation()
-{
-    char location[MAX_LOCATION_LENGTH];
-
-    // Enhance the input prompt color with blue
-    printf("\033[1;33m"); // Blue for the prompt text
-    printf("Enter location to search: ");
-    printf("\033[0m"); // Reset color
-
-    // Using scanf for input
-    printf("\033[1;33m");
-    scanf("%s", location);
-    printf("\033[0m");
-    
-    clearScreen();
-    printf("\033[1;33m"); // Green for searching another location
-    loadingDotsAnimation(2, "Searching Forecast");
-    //printf("\nSearching for forecast in another location...\n");
-    printf("\033[0m");
+//////////////////////////////// END ///////////////////////////////////
 
-    delay(2);
+/////////////////////////// BINARY SNAPSHOT ///////////////////////////////////
 
-    // Call showForecast with cyan text color for the output
-    printf("\033[1;36m"); // Cyan for the forecast output
-    clearScreen();
-    showForecast(location);
-    printf("\033[0m"); // Reset color after displaying forecast
+// Function to append one section to the snapshot being written, padded to the next aligned offset
+int writeSnapshotSection(FILE *file, SnapshotHeader *header, unsigned long long *offset, int section, const void *data, size_t length, unsigned int items, const char *source)
+{
+    static const char padding[SNAPSHOT_ALIGNMENT] = {0};
+    SnapshotSection *entry = &header->sections[section];
+
+    entry->offset = *offset;
+    entry->length = length;
+    entry->checksum = checksumBytes(data, length);
+    entry->items = items;
+    fileStamp(source, &entry->sourceSize, &entry->sourceTime);
+
+    size_t pad = (SNAPSHOT_ALIGNMENT - length % SNAPSHOT_ALIGNMENT) % SNAPSHOT_ALIGNMENT;
+    *offset += length + pad;
+    return (length == 0 || fwrite(data, 1, length, file) == length) && fwrite(padding, 1, pad, file) == pad;
 }
 
-////////////// END //////////////////////////////////////
+// Function to write the station table, its location index, the admins and the users into snapshot.bin.
+// Every section is a plain array the next start maps and uses in place.
+int writeBinarySnapshot()
+{
+    waitForCompaction(); // the station sections are stamped with data.txt as it is on disk
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Pad the columns to a whole alert word; stations.capacity is always a multiple of 64
+    int rows = (count + 63) & ~63;
+    for (int i = count; i < rows; i++)
+    {
+        stations.rainfall[i] = 0;
+        stations.temperature[i] = 0;
+        stations.waterLevel[i] = 0;
+        setAlertBit(stations.alerts, i, 0);
+    }
 
-///////////////////////////////// 232-35-002 /////////////////////////////////////////////////////////////////
+    // Names become one block of NUL-terminated strings plus an offset per station
+    unsigned int *nameOffsets = malloc(((size_t)count + 1) * sizeof(unsigned int));
+    TextBuffer names = {NULL, 0, 0};
+    int ok = nameOffsets != NULL;
+    for (int i = 0; i < count && ok; i++)
+    {
+        size_t length = strlen(stations.location[i]) + 1;
+        ok = names.length + length < 0xffffffffu && reserveText(&names, length);
+        if (ok)
+        {
+            nameOffsets[i] = (unsigned int)names.length;
+            memcpy(names.data + names.length, stations.location[i], length);
+            names.length += length;
+        }
+    }
 
-////////////////// PREDICTION ALGORITHOM//////////////////////
+    char temp[260];
+    snprintf(temp, sizeof(temp), "%s.tmp", snapshot_file);
+    FILE *file = ok ? fopen(temp, "wb") : NULL;
+    if (file == NULL)
+    {
+        free(nameOffsets);
+        free(names.data);
+        return 0;
+    }
 
-// Function to calculate water level based on the given formula
-float calculate_water_level(float rainfall, float temperature)
-{
-    float water_level = (ALPHA * rainfall) + (BETA * temperature) + GAMMA;
-    return water_level * CONVENTION_FACTOR;
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header)); // padding bytes are checksummed too
+    memcpy(header.magic, "FSNP", 4);
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = 0x01020304;
+    header.sectionCount = SNAPSHOT_SECTIONS;
+    header.walSequence = walSequence;
+
+    // Sections follow the header; the header itself is written last, once the checksums are known
+    unsigned long long offset = (sizeof(header) + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+    char *blank = calloc(1, (size_t)offset);
+    ok = blank != NULL && fwrite(blank, 1, (size_t)offset, file) == offset;
+    free(blank);
+
+    ok = ok && writeSnapshotSection(file, &header, &offset, SNAPSHOT_RAINFALL, stations.rainfall, (size_t)rows * sizeof(float), (unsigned int)count, input_file);
+    ok = ok && writeSnapshotSection(file, &header, &offset, SNAPSHOT_TEMPERATURE, stations.temperature, (size_t)rows * sizeof(float), (unsigned int)count, input_file);
+    ok = ok && writeSnapshotSection(file, &header, &offset, SNAPSHOT_WATER_LEVEL, stations.waterLevel, (size_t)rows * sizeof(float), (unsigned int)count, input_file);
+    ok = ok && writeSnapshotSection(file, &header, &offset, SNAPSHOT_ALERTS, stations.alerts, (size_t)rows / 64 * sizeof(unsigned long long), (unsigned int)count, input_file);
+    ok = ok && writeSnapshotSection(file, &header, &offset, SNAPSHOT_NAME_OFFSETS, nameOffsets, (size_t)count * sizeof(unsigned int), (unsigned int)count, input_file);
+    ok = ok && writeSnapshotSection(file, &header, &offset, SNAPSHOT_NAMES, names.data, names.length, (unsigned int)count, input_file);
+    ok = ok && writeSnapshotSection(file, &header, &offset, SNAPSHOT_INDEX, locationIndex, (size_t)locationIndexCapacity * sizeof(int), (unsigned int)count, input_file);
+    ok = ok && writeSnapshotSection(file, &header, &offset, SNAPSHOT_ADMINS, admins, (size_t)adminCount * sizeof(Admin), (unsigned int)adminCount, "data_base/admins.txt");
+    ok = ok && writeSnapshotSection(file, &header, &offset, SNAPSHOT_USERS, users, (size_t)userCount * sizeof(User), (unsigned int)userCount, "data_base/users.txt");
+
+    header.headerChecksum = checksumBytes(&header, offsetof(SnapshotHeader, headerChecksum));
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    syncFile(file);
+    ok = fclose(file) == 0 && ok;
+
+    free(nameOffsets);
+    free(names.data);
+    if (!ok || !replaceFile(temp, snapshot_file))
+    {
+        remove(temp);
+        return 0;
+    }
+    return 1;
 }
 
-///////////////////////// END /////////////////////////////
-
-////////////////// UPDATE PREDICTIONS WITH NEW DATA//////////////////////
+// Function to check that a snapshot section still mirrors its text file
+int snapshotSectionCurrent(const SnapshotSection *section, const char *source)
+{
+    long long size, time;
+    fileStamp(source, &size, &time);
+    return section->sourceSize == size && section->sourceTime == time;
+}
 
-// Function to update predictions and alert status in a new prediction file
-void update_predictions(const char *input_file, const char *output_file)
+// Function to read and check the snapshot header; returns 0 when the file is missing or foreign
+int readSnapshotHeader(const char *data, size_t size, SnapshotHeader *header)
 {
-    FILE *file = fopen(input_file, "r");
-    if (file == NULL)
+    if (size < sizeof(*header))
     {
-        printf("\033[1;31m"); // Red for error message
-        printf("Error: Could not open prediction file.\n");
-        printf("\033[0m"); // Reset color
-        return;
+        return 0;
     }
+    memcpy(header, data, sizeof(*header));
+    return memcmp(header->magic, "FSNP", 4) == 0 && header->version == SNAPSHOT_VERSION &&
+           header->byteOrder == 0x01020304 && header->sectionCount == SNAPSHOT_SECTIONS &&
+           header->headerChecksum == checksumBytes(header, offsetof(SnapshotHeader, headerChecksum));
+}
 
-    // Open a new file for writing the predictions
-    FILE *prediction_file = fopen(output_file, "w");
-    if (prediction_file == NULL)
+// Function to check whether snapshot.bin already matches the tables in memory, so it need not be rewritten
+int snapshotIsCurrent()
+{
+    char raw[sizeof(SnapshotHeader)];
+    SnapshotHeader header;
+    FILE *file = fopen(snapshot_file, "rb");
+    if (file == NULL)
     {
-        printf("\033[1;31m"); // Red for error message
-        printf("Error: Could not create prediction file.\n");
-        printf("\033[0m"); // Reset color
-        fclose(file);
-        return;
+        return 0;
     }
+    int ok = fread(raw, sizeof(raw), 1, file) == 1;
+    fclose(file);
 
-    char area_name[50];
-    float rainfall, temperature, predicted_water_level;
-    char alert_status[10]; // To store "Alert ON" or "Alert OFF"
+    return ok && readSnapshotHeader(raw, sizeof(raw), &header) &&
+           header.walSequence == walSequence &&
+           header.sections[SNAPSHOT_RAINFALL].items == (unsigned int)count &&
+           snapshotSectionCurrent(&header.sections[SNAPSHOT_RAINFALL], input_file) &&
+           snapshotSectionCurrent(&header.sections[SNAPSHOT_ADMINS], "data_base/admins.txt") &&
+           snapshotSectionCurrent(&header.sections[SNAPSHOT_USERS], "data_base/users.txt");
+}
 
-    // Reading each line from the input file
-    while (fscanf(file, "%s %f %f", area_name, &rainfall, &temperature) == 3)
+// Function to adopt the station table from a verified snapshot: the columns and the location index
+// are used in place inside the mapping, only the name pointers are rebuilt. Returns 0 when unusable.
+int adoptSnapshotStations(const char *data, const SnapshotHeader *header)
+{
+    const SnapshotSection *sections = header->sections;
+    unsigned int stationCount = sections[SNAPSHOT_RAINFALL].items;
+    unsigned long long rows = sections[SNAPSHOT_RAINFALL].length / sizeof(float);
+    unsigned long long buckets = sections[SNAPSHOT_INDEX].length / sizeof(int);
+    unsigned long long namesLength = sections[SNAPSHOT_NAMES].length;
+    const char *names = data + sections[SNAPSHOT_NAMES].offset;
+
+    if (rows % 64 != 0 || stationCount > rows || rows > 0x7fffffff ||
+        sections[SNAPSHOT_TEMPERATURE].length != rows * sizeof(float) ||
+        sections[SNAPSHOT_WATER_LEVEL].length != rows * sizeof(float) ||
+        sections[SNAPSHOT_ALERTS].length != rows / 64 * sizeof(unsigned long long) ||
+        sections[SNAPSHOT_NAME_OFFSETS].length != (unsigned long long)stationCount * sizeof(unsigned int) ||
+        (stationCount > 0 && (namesLength == 0 || names[namesLength - 1] != '\0')) ||
+        buckets < 16 || (buckets & (buckets - 1)) != 0 || buckets < 2ULL * stationCount)
     {
-        // Calculate water level using the formula
-        predicted_water_level = calculate_water_level(rainfall, temperature);
+        return 0;
+    }
 
-        // Decide alert status based on the water level threshold
-        if (predicted_water_level > THRESHOLD_WATER_LEVEL)
-        {
-            strcpy(alert_status, "ON");
-        }
-        else
+    // The only per-station work at startup: point each name into the mapped name block
+    char **location = malloc((rows > 0 ? rows : 1) * sizeof(char *));
+    int *curve = malloc((rows > 0 ? rows : 1) * sizeof(int));
+    int *parameters = malloc((rows > 0 ? rows : 1) * sizeof(int));
+    const unsigned int *nameOffsets = (const unsigned int *)(data + sections[SNAPSHOT_NAME_OFFSETS].offset);
+    if (location == NULL || curve == NULL || parameters == NULL)
+    {
+        free(location);
+        free(curve);
+        free(parameters);
+        return 0;
+    }
+    memset(curve, 0xff, (rows > 0 ? rows : 1) * sizeof(int)); // -1 everywhere, the models are loaded later
+    memset(parameters, 0xff, (rows > 0 ? rows : 1) * sizeof(int));
+    for (unsigned int i = 0; i < stationCount; i++)
+    {
+        if (nameOffsets[i] >= namesLength)
         {
-            strcpy(alert_status, "OFF");
+            free(location);
+            free(curve);
+            free(parameters);
+            return 0;
         }
-
-        // Write the updated data to the prediction file
-        fprintf(prediction_file, "%s %.2f %.2f %.2f %s\n", area_name, rainfall, temperature, predicted_water_level, alert_status);
+        location[i] = (char *)names + nameOffsets[i];
     }
 
-    // Close both files
-    fclose(file);
-    fclose(prediction_file);
+    stations.rainfall = (float *)(data + sections[SNAPSHOT_RAINFALL].offset);
+    stations.temperature = (float *)(data + sections[SNAPSHOT_TEMPERATURE].offset);
+    stations.waterLevel = (float *)(data + sections[SNAPSHOT_WATER_LEVEL].offset);
+    stations.alerts = (unsigned long long *)(data + sections[SNAPSHOT_ALERTS].offset);
+    stations.location = location;
+    stations.curve = curve;
+    stations.parameters = parameters;
+    stations.capacity = (int)rows;
+    count = (int)stationCount;
+    stationColumnsMapped = 1;
+
+    locationIndex = (int *)(data + sections[SNAPSHOT_INDEX].offset);
+    locationIndexCapacity = (unsigned int)buckets;
+    locationIndexMapped = 1;
+
+    // Log records up to the snapshot's sequence are already in these columns
+    snapshotSequence = header->walSequence;
+    walSequence = header->walSequence;
+    return 1;
 }
 
-//////////////////////////// END ///////////////////////////////////////
+// Function to load whatever snapshot.bin still mirrors. Every section is checksummed; a section whose
+// text file changed since the snapshot is skipped and must be imported from the text file instead.
+// Returns SNAPSHOT_LOADED_* flags.
+int loadBinarySnapshot()
+{
+    MappedFile mapped = {NULL, 0};
+    int isMapped = mapFile(snapshot_file, &mapped, 1); // private pages: edits never reach the file
+    if (!isMapped && !loadFile(snapshot_file, &mapped))
+    {
+        return 0;
+    }
 
-//////////////// DISPLAY ALERT FOR ADMIN ///////////////////////////////////////
+    SnapshotHeader header;
+    int valid = readSnapshotHeader(mapped.data, mapped.size, &header);
+    for (int i = 0; i < SNAPSHOT_SECTIONS && valid; i++)
+    {
+        const SnapshotSection *section = &header.sections[i];
+        valid = section->offset % SNAPSHOT_ALIGNMENT == 0 && section->offset <= mapped.size &&
+                section->length <= mapped.size - section->offset &&
+                section->checksum == checksumBytes(mapped.data + section->offset, (size_t)section->length);
+    }
 
-// Function to display the alert table from the prediction file
-void view_alert(const char *prediction_file)
-{
-    FILE *file = fopen(prediction_file, "r");
-    if (file == NULL)
+    int loaded = 0;
+#ifndef USE_RECORD_STORE // the stations come from stations.rec, which the snapshot doesn't mirror
+    if (valid && snapshotSectionCurrent(&header.sections[SNAPSHOT_RAINFALL], input_file) &&
+        adoptSnapshotStations(mapped.data, &header))
     {
-        printf("\033[1;31m"); // Red for error message
-        printf("Error: Could not open prediction file.\n");
-        printf("\033[0m"); // Reset color
-        return;
+        loaded |= SNAPSHOT_LOADED_STATIONS;
     }
+#endif
 
-    char area_name[50], alert_status[10];
-    float rainfall, temperature, predicted_water_level;
+    const SnapshotSection *section = &header.sections[SNAPSHOT_ADMINS];
+    if (valid && snapshotSectionCurrent(section, "data_base/admins.txt") &&
+        section->items <= MAX_USERS && section->length == section->items * sizeof(Admin))
+    {
+        memcpy(admins, mapped.data + section->offset, (size_t)section->length);
+        adminCount = (int)section->items;
+        loaded |= SNAPSHOT_LOADED_ADMINS;
+    }
 
-    // Print the table header
-    printf("\033[1;34m"); // Blue for header text
-    printf("%-15s %-15s %-15s %-25s %-10s\n", "Area", "Rainfall(mm)", "Temperature(C)", "Predicted Water Level(M)", "Alert");
-    printf("--------------------------------------------------------------------------------\n");
-    printf("\033[0m"); // Reset color
+    section = &header.sections[SNAPSHOT_USERS];
+    if (valid && snapshotSectionCurrent(section, "data_base/users.txt") &&
+        section->items <= MAX_USERS && section->length == section->items * sizeof(User))
+    {
+        memcpy(users, mapped.data + section->offset, (size_t)section->length);
+        userCount = (int)section->items;
+        loaded |= SNAPSHOT_LOADED_USERS;
+    }
 
-    // Reading each line from the prediction file
-    while (fscanf(file, "%s %f %f %f %s", area_name, &rainfall, &temperature, &predicted_water_level, alert_status) == 5)
+    // The station table keeps using the snapshot memory for the rest of the run
+    if (!(loaded & SNAPSHOT_LOADED_STATIONS))
     {
-        // Color code the alert status (Green for safe, Red for alert)
-        if (strcmp(alert_status, "OFF") == 0)
+        if (isMapped)
         {
-            printf("\033[1;32m"); // Green for safe
+            unmapFile(&mapped);
         }
-        else if (strcmp(alert_status, "ON") == 0)
+        else
         {
-            printf("\033[1;31m"); // Red for alert
+            free((void *)mapped.data);
         }
-
-        // Print the formatted data row
-        printf("%-15s %-15.2f %-15.2f %-25.2f %-10s\n", area_name, rainfall, temperature, predicted_water_level, alert_status);
-
-        printf("\033[0m"); // Reset color after each row
     }
-
-    fclose(file);
+    return loaded;
 }
 
 //////////////////////////////// END ///////////////////////////////////
@@ -1064,7 +8337,10 @@ void adminMenu()
         printf("3. Update existing environmental data\n");
         printf("4. Delete environmental data\n"); // Add delete option
         printf("5. Add New Admin\n");
-        printf("6. Logout\n");
+        printf("6. Record observed water level\n");
+        printf("7. Calibrate model from history\n");
+        printf("8. Ensemble forecast\n");
+        printf("9. Logout\n");
         printf("\033[0m"); // Reset color
         printf("\n");
 
@@ -1081,8 +8357,8 @@ void adminMenu()
             printf("\033[1;32m"); // Green for action
             printf("Inputting Environmental Data\n");
             printf("\033[0m");
-            inputData(data, &count); // Take environmental data as input
-            update_predictions(input_file, prediction_file); //new
+            inputData(); // Take environmental data as input
+            patch_predictions(input_file, prediction_file); // recompute only the changed rows
             break;
         /*case 2:
             clearScreen();
@@ -1108,16 +8384,16 @@ void adminMenu()
             printf("\033[1;32m"); // Green for action
             printf("Updating Existing Environmental Data...\n\n");
             printf("\033[0m");
-            updateData(data, count); // Update existing environmental data
-            update_predictions(input_file, prediction_file); //new
+            updateData(); // Update existing environmental data
+            patch_predictions(input_file, prediction_file); // recompute only the changed rows
             break;
         case 4:
             clearScreen();
             printf("\033[1;32m"); // Green for action
             printf("Delete Environmental Data\n\n");
             printf("\033[0m");
-            deleteData(data, &count); // Call the deleteData function to remove data based on location
-            update_predictions(input_file, prediction_file); //new
+            deleteData(); // Call the deleteData function to remove data based on location
+            patch_predictions(input_file, prediction_file); // recompute only the changed rows
             break;
         case 5:
             clearScreen();
@@ -1127,6 +8403,27 @@ void adminMenu()
             registerAdmin(admins[loggedInAdminIndex].adminID); // Call function to add a new admin
             break;
         case 6:
+            clearScreen();
+            printf("\033[1;32m"); // Green for action
+            printf("Record Observed Water Level\n\n");
+            printf("\033[0m");
+            recordObservedLevel(); // gauge readings the calibration fits against
+            break;
+        case 7:
+            clearScreen();
+            printf("\033[1;32m"); // Green for action
+            printf("Calibrating Model\n\n");
+            printf("\033[0m");
+            calibrateModel(); // fit per-station coefficients and rebuild the predictions
+            break;
+        case 8:
+            clearScreen();
+            printf("\033[1;32m"); // Green for action
+            printf("Ensemble Forecast\n\n");
+            printf("\033[0m");
+            ensembleForecast(); // percentiles and danger probability of every station
+            break;
+        case 9:
             clearScreen();
             printf("\033[1;33m"); // Yellow for logging out
             loadingDotsAnimation(1,"Logging Out");
@@ -1140,7 +8437,7 @@ void adminMenu()
             printf("\033[0m");
         }
 
-        if (choice != 6)
+        if (choice != 9)
         {
             printf("\n\033[1;36m"); // Cyan color for continue prompt
             printf("Press Enter to Continue.");
@@ -1148,7 +8445,7 @@ void adminMenu()
             getchar();         // Wait for user to press Enter before clearing
             printf("\033[0m"); // Reset color
         }
-    } while (choice != 6);
+    } while (choice != 9);
 }
 
 // after login
@@ -1313,6 +8610,15 @@ void loginPage()
             // delay();
             printf("\033[1;33m"); // Yellow for exit message
             printf("\nExiting program. Goodbye!\n");
+            waitForCompaction(); // let a background snapshot finish
+            flushHistory();
+#ifdef USE_RECORD_STORE
+            compactStationLog(1); // export data.txt if the record store is ahead of it
+#endif
+            if (!snapshotIsCurrent())
+            {
+                writeBinarySnapshot();
+            }
             delay(2);
             printf("\033[0m");
             exit(0);
@@ -1335,11 +8641,68 @@ void loginPage()
 
 ////////////// MAIN FUCTION //////////////////////////////
 
+////////////////////////////// STARTUP //////////////////////////////
+
+// Function to bring every table into memory at startup
+void loadTables()
+{
+    // Use the binary snapshot where it still mirrors the text files, import the rest from text
+    int fromSnapshot = loadBinarySnapshot();
+    loadHistory();
+    if (!(fromSnapshot & SNAPSHOT_LOADED_ADMINS))
+    {
+        loadAdminFromFile();
+    }
+    if (!(fromSnapshot & SNAPSHOT_LOADED_USERS))
+    {
+        loadUsersFromFile();
+    }
+    if (!(fromSnapshot & SNAPSHOT_LOADED_STATIONS))
+    {
+        loadDataFromFile(); // station table stays resident for every admin operation
+        rebuildLocationIndex();
+    }
+
+    loadStationParameters(); // calibrated coefficients, used by every prediction below
+    loadEnsembleSettings();
+    loadRiverNetwork(); // reaches between stations, routed into the lead-time forecasts
+    loadHydrographs();  // delayed rainfall response of the stations that have one
+    loadRatingCurves(); // stage-discharge curves replacing CONVENTION_FACTOR
+
+    int replayed = recoverStationLog();
+    if (replayed > 0)
+    {
+        // fold what the last session logged into data.txt and bring the predictions up to date
+        compactStationLog(1);
+        update_predictions(input_file, prediction_file);
+    }
+    if (!(fromSnapshot & SNAPSHOT_LOADED_STATIONS) || replayed > 0 || stationModelsCustomized())
+    {
+        computeWaterLevels(0, count); // the snapshot already holds them otherwise
+    }
+    else
+    {
+        computeLeadForecasts(0, count); // the snapshot doesn't carry the lead-time forecasts
+    }
+    loadGaugeFilter();         // where the last session left the gauge filter
+    assimilateGaugeReadings(); // corrections of the shown levels by the observed ones
+    int allLoaded = SNAPSHOT_LOADED_STATIONS | SNAPSHOT_LOADED_ADMINS | SNAPSHOT_LOADED_USERS;
+#ifdef USE_RECORD_STORE
+    allLoaded &= ~SNAPSHOT_LOADED_STATIONS;
+#endif
+    if (fromSnapshot != allLoaded || !snapshotIsCurrent())
+    {
+        writeBinarySnapshot(); // next start only pages the tables in
+    }
+}
+
+//////////////////////////////// END ///////////////////////////////////
+
+#ifndef FLOOD_NO_MAIN // the benchmarks in testing/ include this file and provide their own main
 int main()
 {
 
-    loadAdminFromFile();
-    loadUsersFromFile();
+    loadTables();
 
     clearScreen();
     printf("\033[1;33m"); // Green color for the title
@@ -1356,3 +8719,4 @@ int main()
 
     return 0;
 }
+#endif
@@ -0,0 +1,76 @@
+// Benchmark for the gauge filter: one assimilation round over a million stations, the scalar update
+// kernel against the AVX2 one, and whether their filter states are identical.
+// build: gcc -O2 testing/bench_assimilation.c -o bench_assimilation -pthread -lm
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define RECORDS 1000000
+#define ROUNDS 24 // a day of hourly readings
+
+double errorIn[RECORDS], biasIn[RECORDS], p00In[RECORDS], p01In[RECORDS], p11In[RECORDS];
+double observedIn[ROUNDS][RECORDS], predictedIn[ROUNDS][RECORDS], decayIn[RECORDS], hoursIn[RECORDS];
+double expectedBias[RECORDS];
+
+// Function to run every round through one kernel from the prior state, in ms per round
+double timeKernel(void (*kernel)(const KalmanBatch *, int, int))
+{
+    for (int i = 0; i < RECORDS; i++)
+    {
+        errorIn[i] = 0;
+        biasIn[i] = 0;
+        p00In[i] = KALMAN_ERROR_SD * KALMAN_ERROR_SD;
+        p01In[i] = 0;
+        p11In[i] = KALMAN_BIAS_SD * KALMAN_BIAS_SD;
+    }
+    double start = nowSeconds();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        KalmanBatch batch = {errorIn, biasIn, p00In, p01In, p11In, observedIn[r], predictedIn[r], decayIn, hoursIn};
+        kernel(&batch, 0, RECORDS);
+    }
+    return (nowSeconds() - start) * 1e3 / ROUNDS;
+}
+
+int main()
+{
+    unsigned int seed = 12345;
+    for (int i = 0; i < RECORDS; i++)
+    {
+        hoursIn[i] = 1;
+        decayIn[i] = exp(-hoursIn[i] / KALMAN_ERROR_HOURS);
+    }
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        for (int i = 0; i < RECORDS; i++)
+        {
+            // every station's model reads low by (i % 100) cm, plus gauge noise
+            nextRandom(&seed);
+            predictedIn[r][i] = 5 + (seed >> 8) % 1500 / 100.0;
+            observedIn[r][i] = predictedIn[r][i] + (i % 100) / 100.0 + ((int)((seed >> 4) % 100) - 50) / 1000.0;
+        }
+    }
+
+    printf("%d stations, %d rounds\n", RECORDS, ROUNDS);
+    printf("%-10s %-14s %-10s\n", "Kernel", "ms/round", "Speedup");
+    double scalar = timeKernel(kalman_update_batch_scalar);
+    printf("%-10s %-14.2f %-10.2f\n", "scalar", scalar, 1.0);
+    memcpy(expectedBias, biasIn, sizeof(biasIn));
+    double drift = 0;
+    for (int i = 0; i < RECORDS; i++)
+    {
+        double missed = fabs(errorIn[i] + biasIn[i] - (i % 100) / 100.0);
+        drift = missed > drift ? missed : drift;
+    }
+#ifdef HAVE_X86_KERNELS
+    if (__builtin_cpu_supports("avx2"))
+    {
+        double simd = timeKernel(kalman_update_batch_avx2);
+        printf("%-10s %-14.2f %-10.2f%s\n", "avx2", simd, scalar / simd,
+               memcmp(expectedBias, biasIn, sizeof(biasIn)) == 0 ? "" : " (MISMATCH)");
+    }
+#endif
+    printf("largest miss of the corrected offset after %d readings: %.3f m\n", ROUNDS, drift);
+    return 0;
+}
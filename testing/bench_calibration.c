@@ -0,0 +1,81 @@
+// Benchmark for model calibration: fit 2000 stations from a year of hourly history
+// with a gauge reading every 3 hours, on 1 thread and on every core.
+// build: gcc -O2 testing/bench_calibration.c -o bench_calibration -pthread -lm
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define STATIONS 2000
+#define HOURS (365 * 24)
+
+int main()
+{
+    char directory[] = "/tmp/flood_calibrationXXXXXX";
+    char path[256];
+    if (mkdtemp(directory) == NULL)
+    {
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/gauges.txt", directory);
+    gauge_file = path;
+
+    // Each station has its own true coefficients; gauges read the model level plus a little noise
+    unsigned int seed = 12345;
+    long long start = 1700000000LL;
+    char name[MAX_LOCATION_LENGTH];
+    FILE *gauges = fopen(gauge_file, "w");
+    for (int s = 0; s < STATIONS; s++)
+    {
+        sprintf(name, "Station%d", s);
+        HistorySeries *series = findHistorySeries(name, 1);
+        double alpha = 0.5 + (s % 100) / 100.0, beta = 0.01 + (s % 5) / 100.0, gamma = 5 + s % 6;
+        for (int h = 0; h < HOURS; h++)
+        {
+            nextRandom(&seed);
+            float rain = roundToStored(((seed >> 8) % 3000) / 100.0f);
+            float temperature = roundToStored(20 + 8 * (float)((h % 24) - 12) / 12 + (float)((seed >> 12) % 100) / 100.0f);
+            long long time = start + (long long)h * 3600;
+            appendHistoryPoint(series, time, rain, temperature);
+            if (h % 3 == 0)
+            {
+                double noise = ((int)((seed >> 4) % 101) - 50) / 1000.0; // +-5 cm
+                fprintf(gauges, "%s %lld %.2f\n", name, time + 600, (alpha * rain + beta * temperature + gamma) * CONVENTION_FACTOR + noise);
+            }
+        }
+    }
+    fclose(gauges);
+
+    printf("%-10s %-12s %-10s %s\n", "Threads", "Seconds", "Fitted", "Station0 alpha/beta/gamma (true 0.5/0.01/5)");
+    int threads[] = {1, threadPoolSize()};
+    CalibrationJob reference = {0};
+    for (int i = 0; i < 2; i++)
+    {
+        setThreadPoolSize(threads[i]);
+        CalibrationJob job;
+        double begin = nowSeconds();
+        int fitted = fitStationModels(&job);
+        double elapsed = nowSeconds() - begin;
+
+        CalibrationStation *first = &job.stations[0];
+        printf("%-10d %-12.3f %-10d %.4f/%.4f/%.4f\n", threads[i], elapsed, fitted, first->alpha, first->beta, first->gamma);
+        if (i == 0)
+        {
+            reference = job;
+            continue;
+        }
+        for (int s = 0; s < job.count; s++)
+        {
+            if (job.stations[s].alpha != reference.stations[s].alpha || job.stations[s].gamma != reference.stations[s].gamma)
+            {
+                printf("fit of station %d depends on the thread count\n", s);
+            }
+        }
+        freeCalibrationJob(&job);
+    }
+    freeCalibrationJob(&reference);
+
+    remove(gauge_file);
+    rmdir(directory);
+    return 0;
+}
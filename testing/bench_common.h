@@ -0,0 +1,28 @@
+// Helpers shared by the benchmarks, included right after ../main.c: the clock they time with
+// and the generator of their synthetic readings, so every run sees the same inputs.
+
+#include <time.h>
+
+// Function to read a monotonic clock in seconds
+double nowSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Function to advance the benchmarks' linear congruential generator, returns the new seed
+unsigned int nextRandom(unsigned int *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed;
+}
+
+// Function to draw one reading in hundredths: rainfall below rainfallSpan, temperature from
+// temperatureBase up to temperatureBase + temperatureSpan (spans in hundredths)
+void randomReading(unsigned int *seed, unsigned int rainfallSpan, unsigned int temperatureSpan, float temperatureBase,
+                   float *rainfall, float *temperature)
+{
+    *rainfall = (nextRandom(seed) >> 8) % rainfallSpan / 100.0f;
+    *temperature = (int)((nextRandom(seed) >> 8) % temperatureSpan) / 100.0f + temperatureBase;
+}
@@ -0,0 +1,78 @@
+// Benchmark for the unit hydrograph convolution: direct (scalar and AVX2) against the FFT path
+// over two years of hourly rainfall, for kernels from 8 to 4096 hours.
+// build: gcc -O2 testing/bench_convolution.c -o bench_convolution -pthread -lm
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define SERIES_HOURS (2 * 365 * 24)
+
+float signalIn[SERIES_HOURS + MAX_HYDROGRAPH_LENGTH];
+float kernelIn[MAX_HYDROGRAPH_LENGTH];
+float expected[SERIES_HOURS], out[SERIES_HOURS];
+
+// Function to time one convolution path in ms, repeating it until it has run for a while
+double timePath(void (*path)(const float *, const float *, int, float *, int), int length)
+{
+    int rounds = 0;
+    double start = nowSeconds(), elapsed;
+    do
+    {
+        path(signalIn, kernelIn, length, out, SERIES_HOURS);
+        rounds++;
+        elapsed = nowSeconds() - start;
+    } while (elapsed < 0.2);
+    return elapsed * 1e3 / rounds;
+}
+
+// Function to run the FFT path with the signature of the direct ones
+void fftPath(const float *signal, const float *kernel, int length, float *output, int outputs)
+{
+    convolveFft(signal, kernel, length, output, outputs);
+}
+
+int main()
+{
+    unsigned int seed = 12345;
+    for (int i = 0; i < SERIES_HOURS + MAX_HYDROGRAPH_LENGTH; i++)
+    {
+        nextRandom(&seed);
+        signalIn[i] = (seed >> 8) % 6 == 0 ? (seed >> 12) % 4000 / 100.0f : 0; // rain in one hour out of six
+    }
+
+    int lengths[] = {8, 16, 32, 64, 128, 256, 512, 1024, 4096};
+    printf("%d hourly values per series\n", SERIES_HOURS);
+    printf("%-8s %-12s %-12s %-12s %-12s %-10s %-12s\n", "Taps", "Scalar(ms)", "AVX2(ms)", "FFT(ms)", "Auto(ms)", "Auto path", "FFT rel err");
+    for (int l = 0; l < (int)(sizeof(lengths) / sizeof(lengths[0])); l++)
+    {
+        int length = lengths[l];
+        double sum = 0;
+        for (int j = 0; j < length; j++)
+        {
+            kernelIn[j] = (float)(j * exp(-j / (length / 8.0)));
+            sum += kernelIn[j];
+        }
+        for (int j = 0; j < length; j++)
+        {
+            kernelIn[j] /= sum;
+        }
+
+        double scalar = timePath(convolveDirectScalar, length);
+        memcpy(expected, out, sizeof(out));
+        double simd = timePath(convolveDirect, length);
+        int identical = memcmp(expected, out, sizeof(out)) == 0;
+        double fft = timePath(fftPath, length);
+        double error = 0;
+        for (int i = 0; i < SERIES_HOURS; i++)
+        {
+            double difference = fabs(out[i] - expected[i]) / (fabs(expected[i]) + 1);
+            error = difference > error ? difference : error;
+        }
+        double automatic = timePath(convolveSeries, length);
+
+        printf("%-8d %-12.2f %-12.2f %-12.2f %-12.2f %-10s %-12.1e%s\n", length, scalar, simd, fft, automatic,
+               convolutionUsesFft(length, SERIES_HOURS) ? "fft" : "direct", error, identical ? "" : " (AVX2 MISMATCH)");
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+// Benchmark for the ensemble forecast: members per second on 1 thread and on every core,
+// and whether the percentiles are identical on both.
+// build: gcc -O2 testing/bench_ensemble.c -o bench_ensemble -pthread -lm
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define STATIONS 100000
+
+// Function to time one ensemble run over every station on the given number of threads (0 = every core)
+EnsembleResult *timeEnsemble(int threads)
+{
+    setThreadPoolSize(threads);
+    double start = nowSeconds();
+    EnsembleResult *results = runEnsemble();
+    double elapsed = nowSeconds() - start;
+    printf("%-10d %-14.2f %-14.1f\n", threadPoolSize(), elapsed, (double)count * ensembleSettings.members / elapsed / 1e6);
+    return results;
+}
+
+int main()
+{
+    char name[MAX_LOCATION_LENGTH];
+    unsigned int seed = 12345;
+    while (count < STATIONS)
+    {
+        float rainfall, temperature;
+        randomReading(&seed, 5000, 4000, -5.0f, &rainfall, &temperature);
+        sprintf(name, "Station%d", count);
+        insertStation(name, rainfall, temperature);
+    }
+
+    printf("%d stations, %d members each\n", STATIONS, ensembleSettings.members);
+    printf("%-10s %-14s %-14s\n", "Threads", "Seconds", "M members/s");
+    EnsembleResult *single = timeEnsemble(1);
+    EnsembleResult *all = timeEnsemble(0);
+
+    int danger = 0;
+    for (int i = 0; i < count; i++)
+    {
+        danger += single[i].exceedance >= 0.5f;
+    }
+    printf("%d stations likely above the danger level, results %s\n", danger,
+           memcmp(single, all, count * sizeof(EnsembleResult)) == 0 ? "identical on any thread count" : "DIFFER");
+    free(single);
+    free(all);
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Benchmark for the observation history: memory per point and range scan speed for
+// two years of hourly readings from 1000 stations.
+// build: gcc -O2 testing/bench_history.c -o bench_history -pthread -lm
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define STATIONS 1000
+#define HOURS (2 * 365 * 24)
+#define SCANS 20000
+
+void sumPoint(const Observation *point, void *arg)
+{
+    *(double *)arg += point->rainfall;
+}
+
+int main()
+{
+    // Readings arrive hourly with a few seconds of jitter; rain falls in bursts and
+    // temperature follows a daily cycle, both stored with two decimals
+    unsigned int seed = 12345;
+    long long start = 1700000000LL;
+    char name[MAX_LOCATION_LENGTH];
+
+    double begin = nowSeconds();
+    for (int s = 0; s < STATIONS; s++)
+    {
+        sprintf(name, "Station%d", s);
+        HistorySeries *series = findHistorySeries(name, 1);
+        long long time = start;
+        float rain = 0;
+        for (int h = 0; h < HOURS; h++)
+        {
+            nextRandom(&seed);
+            time += 3600 + (long long)((seed >> 8) % 5) - 2;
+            rain = (seed >> 16) % 20 == 0 ? roundToStored(((seed >> 4) % 3000) / 100.0f) : (rain > 1 ? roundToStored(rain * 0.5f) : 0);
+            float temperature = roundToStored(20 + 8 * (float)((h % 24) - 12) / 12 + (float)((seed >> 12) % 100) / 100.0f);
+            appendHistoryPoint(series, time, rain, temperature);
+        }
+    }
+    double appendTime = nowSeconds() - begin;
+
+    size_t bytes = 0;
+    long long points = 0;
+    for (int s = 0; s < historySeriesCount; s++)
+    {
+        for (int c = 0; c < historySeries[s].chunkCount; c++)
+        {
+            bytes += historySeries[s].chunks[c].byteCapacity;
+            points += historySeries[s].chunks[c].points;
+        }
+        bytes += historySeries[s].chunkCapacity * sizeof(HistoryChunk);
+    }
+
+    printf("%lld points, %.1f MB resident (%.2f bytes/point, raw would be %zu)\n", points, bytes / 1e6,
+           (double)bytes / points, sizeof(Observation));
+    printf("append: %.1f ns/point\n", appendTime * 1e9 / points);
+
+    int windows[] = {24, 7 * 24, 30 * 24};
+    for (int w = 0; w < 3; w++)
+    {
+        double total = 0;
+        long long visited = 0;
+        begin = nowSeconds();
+        for (int i = 0; i < SCANS; i++)
+        {
+            nextRandom(&seed);
+            sprintf(name, "Station%u", (seed >> 8) % STATIONS);
+            long long from = start + (long long)((seed >> 4) % (HOURS - windows[w])) * 3600;
+            visited += scanHistory(name, from, from + (long long)windows[w] * 3600, sumPoint, &total);
+        }
+        double elapsed = nowSeconds() - begin;
+        printf("scan %4d h: %.2f us/scan, %.1f ns/point (%lld points, sum %.0f)\n", windows[w], elapsed * 1e6 / SCANS,
+               elapsed * 1e9 / visited, visited, total);
+    }
+    return 0;
+}
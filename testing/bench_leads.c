@@ -0,0 +1,64 @@
+// Benchmark for the lead-time forecasts: one pass per horizon against the single all-lead pass.
+// build: gcc -O2 testing/bench_leads.c -o bench_leads -pthread -lm
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define RECORDS 1000000
+#define ROUNDS 10
+
+float rainfallIn[RECORDS], temperatureIn[RECORDS];
+float expectedLevels[RECORDS * LEAD_TIMES], levels[RECORDS * LEAD_TIMES];
+
+// Function to time one all-lead kernel and compare its output with the per-horizon passes
+void runKernel(const char *name, void (*kernel)(const float *, const float *, float *, int, int), double baseline)
+{
+    memset(levels, 0, sizeof(levels));
+    double start = nowSeconds();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        kernel(rainfallIn, temperatureIn, levels, 0, RECORDS);
+    }
+    double elapsed = (nowSeconds() - start) / ROUNDS;
+
+    int identical = memcmp(levels, expectedLevels, sizeof(levels)) == 0;
+    printf("%-18s %-12.2f %-10.2f %s\n", name, elapsed * 1e3, baseline / elapsed, identical ? "bit-identical" : "MISMATCH");
+}
+
+int main()
+{
+    unsigned int seed = 12345;
+    for (int i = 0; i < RECORDS; i++)
+    {
+        randomReading(&seed, 50000, 6000, -10.0f, &rainfallIn[i], &temperatureIn[i]);
+    }
+    prepareLeadPersistence();
+
+    // One full pass over the table per horizon
+    double start = nowSeconds();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        for (int k = 0; k < LEAD_TIMES; k++)
+        {
+            for (int i = 0; i < RECORDS; i++)
+            {
+                float water_level = (ALPHA * rainfallIn[i] * leadPersistence[k]) + (BETA * temperatureIn[i]) + GAMMA;
+                expectedLevels[i * LEAD_TIMES + k] = (float)(water_level * CONVENTION_FACTOR);
+            }
+        }
+    }
+    double baseline = (nowSeconds() - start) / ROUNDS;
+
+    printf("%d stations, %d lead times\n", RECORDS, LEAD_TIMES);
+    printf("%-18s %-12s %-10s\n", "Path", "ms/table", "Speedup");
+    printf("%-18s %-12.2f %-10.2f\n", "per horizon", baseline * 1e3, 1.0);
+    runKernel("single pass", calculate_lead_levels_batch_scalar, baseline);
+#ifdef HAVE_X86_KERNELS
+    if (__builtin_cpu_supports("avx2"))
+    {
+        runKernel("single pass avx2", calculate_lead_levels_batch_avx2, baseline);
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,69 @@
+// Benchmark for loading data.txt: parallel chunked parsing plus the in-order merge into the station table,
+// with 1, 2, 4 and 8 pool threads.
+// build: gcc -O2 testing/bench_load.c -o bench_load -pthread -lm
+// usage: ./bench_load [stations]
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define BENCH_INPUT "bench_load.txt"
+
+int main(int argc, char *argv[])
+{
+    int stationCount = argc > 1 ? atoi(argv[1]) : 2000000;
+
+    FILE *file = fopen(BENCH_INPUT, "w");
+    unsigned int seed = 12345;
+    for (int i = 0; i < stationCount; i++)
+    {
+        float rainfall, temperature;
+        randomReading(&seed, 50000, 6000, -10.0f, &rainfall, &temperature);
+        fprintf(file, "Station%d %.2f %.2f\n", i, rainfall, temperature);
+    }
+    fclose(file);
+
+    printf("%-10s %-12s %-12s %-10s %-10s\n", "Threads", "Parse (s)", "Load (s)", "Speedup", "Rows");
+    double serial = 0;
+    unsigned long long serialChecksum = 0;
+    for (int threads = 1; threads <= 8; threads *= 2)
+    {
+        setThreadPoolSize(threads);
+        StationColumns columns;
+        parseStationFile(BENCH_INPUT, &columns); // warm the page cache and the pool
+        freeStationColumns(&columns);
+
+        double start = nowSeconds();
+        parseStationFile(BENCH_INPUT, &columns);
+        double parsed = nowSeconds() - start;
+
+        // Merge into a fresh table in file order, as loadDataFromFile does
+        count = 0;
+        for (int i = 0; i < columns.rows; i++)
+        {
+            appendStation(columns.names[i], columns.rainfall[i], columns.temperature[i]);
+        }
+        double loaded = nowSeconds() - start;
+        freeStationColumns(&columns);
+
+        unsigned long long checksum = 0;
+        for (int i = 0; i < count; i++)
+        {
+            unsigned int r, t;
+            memcpy(&r, &stations.rainfall[i], sizeof(r));
+            memcpy(&t, &stations.temperature[i], sizeof(t));
+            checksum = checksum * 31 + hashLocation(stations.location[i]) + r * 7 + t;
+        }
+        if (threads == 1)
+        {
+            serial = loaded;
+            serialChecksum = checksum;
+        }
+
+        printf("%-10d %-12.3f %-12.3f %-10.2f %-10d %s\n", threads, parsed, loaded, serial / loaded, count,
+               checksum == serialChecksum ? "same table" : "TABLE DIFFERS");
+    }
+
+    remove(BENCH_INPUT);
+    return 0;
+}
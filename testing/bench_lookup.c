@@ -0,0 +1,55 @@
+// Benchmark for the location hash index: lookup latency from 100 to 1,000,000 stations.
+// build: gcc -O2 testing/bench_lookup.c -o bench_lookup -pthread -lm
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define LOOKUPS 2000000
+#define QUERIES 4096
+
+char hits[QUERIES][MAX_LOCATION_LENGTH];
+char misses[QUERIES][MAX_LOCATION_LENGTH];
+
+int main()
+{
+    int sizes[] = {100, 1000, 10000, 100000, 1000000};
+    printf("%-12s %-18s %-18s\n", "Stations", "Hit (ns/lookup)", "Miss (ns/lookup)");
+
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++)
+    {
+        char name[MAX_LOCATION_LENGTH];
+        while (count < sizes[s])
+        {
+            sprintf(name, "Station%d", count);
+            insertStation(name, 0, 0); // the index grows along with the store
+        }
+
+        // hits use a different letter case than the stored name
+        unsigned int seed = 12345;
+        for (int i = 0; i < QUERIES; i++)
+        {
+            nextRandom(&seed);
+            sprintf(hits[i], "STATION%u", (seed >> 8) % (unsigned int)count);
+            sprintf(misses[i], "Missing%u", seed >> 8);
+        }
+
+        long found = 0;
+        double start = nowSeconds();
+        for (int i = 0; i < LOOKUPS; i++)
+        {
+            found += findLocation(hits[i % QUERIES]) >= 0;
+        }
+        double hit = (nowSeconds() - start) * 1e9 / LOOKUPS;
+
+        start = nowSeconds();
+        for (int i = 0; i < LOOKUPS; i++)
+        {
+            found += findLocation(misses[i % QUERIES]) >= 0;
+        }
+        double miss = (nowSeconds() - start) * 1e9 / LOOKUPS;
+
+        printf("%-12d %-18.1f %-18.1f (found %ld)\n", count, hit, miss, found);
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+// Benchmark for the line parser: fscanf against LineReader + parseStationLine on a generated data file.
+// build: gcc -O2 testing/bench_parse.c -o bench_parse -pthread -lm
+// usage: ./bench_parse [lines]
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define BENCH_INPUT "bench_parse.txt"
+
+int main(int argc, char *argv[])
+{
+    long lines = argc > 1 ? atol(argv[1]) : 10000000;
+
+    FILE *file = fopen(BENCH_INPUT, "w");
+    unsigned int seed = 12345;
+    for (long i = 0; i < lines; i++)
+    {
+        float rainfall, temperature;
+        randomReading(&seed, 50000, 6000, -10.0f, &rainfall, &temperature);
+        fprintf(file, "Station%ld %.2f %.2f\n", i, rainfall, temperature);
+    }
+    fclose(file);
+
+    char location[MAX_LOCATION_LENGTH];
+    float rainfall, temperature;
+    unsigned long long fscanfSum = 0, parserSum = 0;
+    long fscanfRows = 0, parserRows = 0;
+
+    // Old path: fscanf token by token
+    double start = nowSeconds();
+    file = fopen(BENCH_INPUT, "r");
+    while (fscanf(file, "%49s %f %f", location, &rainfall, &temperature) == 3)
+    {
+        unsigned int r, t;
+        memcpy(&r, &rainfall, sizeof(r));
+        memcpy(&t, &temperature, sizeof(t));
+        fscanfSum = fscanfSum * 31 + r * 7 + t + location[strlen(location) - 1];
+        fscanfRows++;
+    }
+    fclose(file);
+    double fscanfTime = nowSeconds() - start;
+
+    // New path: zero-copy lines and the hand-written float parser
+    start = nowSeconds();
+    LineReader reader;
+    const char *line;
+    size_t length;
+    openLineReader(&reader, BENCH_INPUT);
+    while (nextLine(&reader, &line, &length))
+    {
+        if (parseStationLine(line, length, location, &rainfall, &temperature))
+        {
+            unsigned int r, t;
+            memcpy(&r, &rainfall, sizeof(r));
+            memcpy(&t, &temperature, sizeof(t));
+            parserSum = parserSum * 31 + r * 7 + t + location[strlen(location) - 1];
+            parserRows++;
+        }
+    }
+    closeLineReader(&reader);
+    double parserTime = nowSeconds() - start;
+
+    printf("%-10s %-10s %-14s %-10s\n", "Parser", "Seconds", "Mlines/s", "Speedup");
+    printf("%-10s %-10.3f %-14.2f %-10.2f\n", "fscanf", fscanfTime, fscanfRows / fscanfTime / 1e6, 1.0);
+    printf("%-10s %-10.3f %-14.2f %-10.2f\n", "parser", parserTime, parserRows / parserTime / 1e6, fscanfTime / parserTime);
+    printf("%s\n", fscanfRows == parserRows && fscanfSum == parserSum ? "identical values" : "VALUES DIFFER");
+
+    remove(BENCH_INPUT);
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Benchmark for update_predictions: regeneration time with 1..N pool threads on a generated network.
+// build: gcc -O2 testing/bench_predictions.c -o bench_predictions -pthread -lm
+// usage: ./bench_predictions [stations] [max threads]
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define BENCH_INPUT "bench_data.txt"
+#define BENCH_OUTPUT "bench_predictions.txt"
+#define BENCH_SERIAL "bench_predictions_serial.txt"
+
+// Function to compare two files byte for byte
+int sameFile(const char *a, const char *b)
+{
+    FILE *fa = fopen(a, "rb"), *fb = fopen(b, "rb");
+    int same = fa != NULL && fb != NULL;
+    while (same)
+    {
+        int ca = fgetc(fa), cb = fgetc(fb);
+        same = ca == cb;
+        if (ca == EOF)
+        {
+            break;
+        }
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+
+int main(int argc, char *argv[])
+{
+    int stationCount = argc > 1 ? atoi(argv[1]) : 1000000;
+    int maxThreads = argc > 2 ? atoi(argv[2]) : 8;
+
+    FILE *file = fopen(BENCH_INPUT, "w");
+    unsigned int seed = 12345;
+    for (int i = 0; i < stationCount; i++)
+    {
+        float rainfall, temperature;
+        randomReading(&seed, 50000, 6000, -10.0f, &rainfall, &temperature);
+        fprintf(file, "Station%d %.2f %.2f\n", i, rainfall, temperature);
+    }
+    fclose(file);
+
+    printf("%-10s %-12s %-10s\n", "Threads", "Seconds", "Speedup");
+    double serial = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        setThreadPoolSize(threads);
+        update_predictions(BENCH_INPUT, threads == 1 ? BENCH_SERIAL : BENCH_OUTPUT); // warm the page cache
+
+        double start = nowSeconds();
+        update_predictions(BENCH_INPUT, threads == 1 ? BENCH_SERIAL : BENCH_OUTPUT);
+        double elapsed = nowSeconds() - start;
+        if (threads == 1)
+        {
+            serial = elapsed;
+        }
+
+        printf("%-10d %-12.3f %-10.2f %s\n", threads, elapsed, serial / elapsed,
+               threads == 1 || sameFile(BENCH_SERIAL, BENCH_OUTPUT) ? "identical" : "DIFFERS");
+    }
+
+    remove(BENCH_INPUT);
+    remove(BENCH_OUTPUT);
+    remove(BENCH_SERIAL);
+    remove("bench_predictions.idx");
+    remove("bench_predictions_serial.idx");
+    return 0;
+}
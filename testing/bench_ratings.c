@@ -0,0 +1,103 @@
+// Benchmark for the rating curves: converting a million stations through their curves against the
+// single CONVENTION_FACTOR multiply, with every station or a tenth of them rated, sharing 1,000
+// curves (they stay in cache) or 100,000 (every lookup goes to memory). The kernels are timed on
+// their own and through computeWaterLevels over a station table, which reads the slots' curves.
+// build: gcc -O2 testing/bench_ratings.c -o bench_ratings -pthread -lm
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define RECORDS 1000000
+#define ROUNDS 10
+
+float rainfallIn[RECORDS], temperatureIn[RECORDS];
+float expectedLevels[RECORDS], levels[RECORDS];
+unsigned long long alerts[(RECORDS + 63) / 64];
+int curves[RECORDS];
+
+// Function to time one rated kernel in ms per table
+double timeRated(void (*kernel)(const float *, const float *, const int *, float *, unsigned long long *, int, int))
+{
+    double start = nowSeconds();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        kernel(rainfallIn, temperatureIn, curves, levels, alerts, 0, RECORDS);
+    }
+    return (nowSeconds() - start) * 1e3 / ROUNDS;
+}
+
+int main()
+{
+    unsigned int seed = 12345;
+    for (int i = 0; i < RECORDS; i++)
+    {
+        randomReading(&seed, 5000, 4000, -5.0f, &rainfallIn[i], &temperatureIn[i]);
+    }
+    double start = nowSeconds();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        calculate_water_level_batch(rainfallIn, temperatureIn, levels, alerts, 0, RECORDS);
+    }
+    double baseline = (nowSeconds() - start) * 1e3 / ROUNDS;
+
+    // the same stations as a table; curve c belongs to station 10c
+    char name[MAX_LOCATION_LENGTH];
+    for (int i = 0; i < RECORDS; i++)
+    {
+        sprintf(name, "Station%d", i);
+        insertStation(name, rainfallIn[i], temperatureIn[i]);
+    }
+
+    printf("%d stations, curves of %d knots\n", RECORDS, RATING_POINTS);
+    printf("%-20s %-8s %-12s %-12s %-10s\n", "Path", "Curves", "Rated", "ms/table", "vs factor");
+    printf("%-20s %-8s %-12s %-12.2f %-10.2f\n", "factor multiply", "-", "none", baseline, 1.0);
+    start = nowSeconds();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        computeWaterLevels(0, count); // with the lead-time forecasts
+    }
+    double table = (nowSeconds() - start) * 1e3 / ROUNDS;
+    printf("%-20s %-8s %-12s %-12.2f %-10.2f\n", "computeWaterLevels", "-", "none", table, table / baseline);
+
+    int curveCounts[] = {1000, 100000};
+    int shares[] = {10, 1}; // every tenth station, every station
+    for (int n = 0; n < 2; n++)
+    {
+        while (ratingCurves.count < curveCounts[n])
+        {
+            nextRandom(&seed);
+            sprintf(name, "Station%d", ratingCurves.count * 10);
+            setPowerRatingCurve(name, 1.5 + (seed >> 8) % 300 / 100.0, 1.3 + (seed >> 16) % 60 / 100.0, 2.0 + (seed >> 4) % 400 / 100.0, 40.0);
+        }
+        for (int s = 0; s < 2; s++)
+        {
+            for (int i = 0; i < RECORDS; i++)
+            {
+                curves[i] = i % shares[s] == 0 ? i / shares[s] % curveCounts[n] : -1;
+            }
+            const char *rated = shares[s] == 1 ? "all" : "one in ten";
+            double scalar = timeRated(calculate_rated_levels_batch_scalar);
+            printf("%-20s %-8d %-12s %-12.2f %-10.2f\n", "rated scalar", curveCounts[n], rated, scalar, scalar / baseline);
+#ifdef HAVE_X86_KERNELS
+            if (__builtin_cpu_supports("avx2"))
+            {
+                memcpy(expectedLevels, levels, sizeof(levels));
+                double simd = timeRated(calculate_rated_levels_batch_avx2);
+                printf("%-20s %-8d %-12s %-12.2f %-10.2f%s\n", "rated avx2", curveCounts[n], rated, simd, simd / baseline,
+                       memcmp(levels, expectedLevels, sizeof(levels)) == 0 ? "" : " (MISMATCH)");
+            }
+#endif
+        }
+    }
+
+    // the table converts its slots through the curves they point at: one station in ten has one now
+    start = nowSeconds();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        computeWaterLevels(0, count);
+    }
+    table = (nowSeconds() - start) * 1e3 / ROUNDS;
+    printf("%-20s %-8d %-12s %-12.2f %-10.2f\n", "computeWaterLevels", ratingCurves.count, "one in ten", table, table / baseline);
+    return 0;
+}
@@ -0,0 +1,57 @@
+// Benchmark for the river network: building the CSR lists and waves, and routing every reach,
+// for networks of independent sub-basins from 1,000 to 100,000 reaches.
+// build: gcc -O2 testing/bench_routing.c -o bench_routing -pthread -lm
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define BASIN_NODES 250 // stations per sub-basin
+#define ROUNDS 20
+
+int main()
+{
+    int sizes[] = {4, 20, 100, 400}; // sub-basins
+    unsigned int seed = 12345;
+    int basins = 0;
+
+    printf("%-10s %-8s %-12s %-16s %-16s\n", "Reaches", "Waves", "Build (ms)", "Route 1 thread", "Route all cores");
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++)
+    {
+        // every station of a sub-basin drains into one of the next few stations, the last is its outlet
+        char upstream[MAX_LOCATION_LENGTH], downstream[MAX_LOCATION_LENGTH];
+        for (; basins < sizes[s]; basins++)
+        {
+            for (int i = 0; i < BASIN_NODES; i++)
+            {
+                nextRandom(&seed);
+                sprintf(upstream, "Basin%d_%d", basins, i);
+                insertStation(upstream, (seed >> 8) % 5000 / 100.0f, 25.0f);
+                if (i < BASIN_NODES - 1)
+                {
+                    int span = BASIN_NODES - 1 - i < 4 ? BASIN_NODES - 1 - i : 4;
+                    sprintf(downstream, "Basin%d_%d", basins, i + 1 + (int)((seed >> 4) % span));
+                    addRiverReach(upstream, downstream, 1 + (seed >> 12) % 24, ((seed >> 20) % 6) / 10.0, 1.0);
+                }
+            }
+        }
+
+        double start = nowSeconds();
+        buildRiverNetwork();
+        double build = (nowSeconds() - start) * 1e3;
+
+        double elapsed[2];
+        for (int pass = 0; pass < 2; pass++)
+        {
+            setThreadPoolSize(pass == 0 ? 1 : 0);
+            start = nowSeconds();
+            for (int r = 0; r < ROUNDS; r++)
+            {
+                routeRiverNetwork();
+            }
+            elapsed[pass] = (nowSeconds() - start) * 1e3 / ROUNDS;
+        }
+        printf("%-10d %-8d %-12.2f %-16.2f %-16.2f\n", riverNetwork.reachCount, riverNetwork.waveCount, build, elapsed[0], elapsed[1]);
+    }
+    return 0;
+}
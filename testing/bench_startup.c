@@ -0,0 +1,82 @@
+// Benchmark for startup: importing data.txt against adopting the binary snapshot (data_base/snapshot.bin).
+// Runs in a scratch directory under /tmp.
+// build: gcc -O2 testing/bench_startup.c -o bench_startup -pthread -lm
+// usage: ./bench_startup [stations]
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+// Function to fingerprint the station table in slot order
+unsigned long long tableChecksum()
+{
+    unsigned long long sum = checksumBytes(stations.rainfall, (size_t)count * sizeof(float));
+    sum = sum * 31 + checksumBytes(stations.temperature, (size_t)count * sizeof(float));
+    sum = sum * 31 + checksumBytes(stations.waterLevel, (size_t)count * sizeof(float));
+    for (int i = 0; i < count; i++)
+    {
+        sum = sum * 31 + hashLocation(stations.location[i]);
+    }
+    return sum;
+}
+
+int main(int argc, char *argv[])
+{
+    int stationCount = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    char directory[] = "/tmp/flood_bench_XXXXXX";
+    if (mkdtemp(directory) == NULL || chdir(directory) != 0)
+    {
+        printf("Could not create a scratch directory.\n");
+        return 1;
+    }
+    mkdir("data_base", 0755);
+
+    FILE *file = fopen(input_file, "w");
+    unsigned int seed = 12345;
+    for (int i = 0; i < stationCount; i++)
+    {
+        float rainfall, temperature;
+        randomReading(&seed, 50000, 6000, -10.0f, &rainfall, &temperature);
+        fprintf(file, "Station%d %.2f %.2f\n", i, rainfall, temperature);
+    }
+    fclose(file);
+
+    // Text import: parse, index and compute the water levels
+    double start = nowSeconds();
+    loadDataFromFile();
+    rebuildLocationIndex();
+    computeWaterLevels(0, count);
+    double imported = nowSeconds() - start;
+    unsigned long long importedChecksum = tableChecksum();
+
+    start = nowSeconds();
+    writeBinarySnapshot();
+    double written = nowSeconds() - start;
+
+    // Forget the table (its memory is simply leaked here) and adopt the snapshot instead
+    memset(&stations, 0, sizeof(stations));
+    count = 0;
+    locationIndex = NULL;
+    locationIndexCapacity = 0;
+
+    start = nowSeconds();
+    int loaded = loadBinarySnapshot();
+    double adopted = nowSeconds() - start;
+
+    printf("%-26s %-10s\n", "Step", "Seconds");
+    printf("%-26s %-10.3f\n", "import data.txt", imported);
+    printf("%-26s %-10.3f\n", "write snapshot.bin", written);
+    printf("%-26s %-10.3f (%.1fx faster)\n", "adopt snapshot.bin", adopted, imported / adopted);
+    printf("%s, %d stations, lookup %s\n",
+           (loaded & SNAPSHOT_LOADED_STATIONS) && tableChecksum() == importedChecksum ? "same table" : "TABLE DIFFERS",
+           count, findLocation("station42") == 42 ? "ok" : "FAILED");
+
+    remove(input_file);
+    remove(snapshot_file);
+    remove("data_base/data.txt.tmp");
+    rmdir("data_base");
+    chdir("/");
+    rmdir(directory);
+    return 0;
+}
@@ -0,0 +1,68 @@
+// Benchmark for the water level kernels: per-record path against the scalar, SSE2 and AVX2 batch kernels.
+// build: gcc -O2 testing/bench_water_level.c -o bench_water_level -pthread -lm
+
+#define FLOOD_NO_MAIN
+#include "../main.c"
+#include "bench_common.h"
+
+#define RECORDS 1000000
+#define ROUNDS 20
+
+float rainfallIn[RECORDS], temperatureIn[RECORDS];
+float expectedLevel[RECORDS], level[RECORDS];
+unsigned long long expectedAlerts[RECORDS / 64 + 1], alertWords[RECORDS / 64 + 1];
+
+// Function to time one batch kernel and compare its output with the per-record path
+void runKernel(const char *name, void (*kernel)(const float *, const float *, float *, unsigned long long *, int, int), double baseline)
+{
+    memset(level, 0, sizeof(level));
+    memset(alertWords, 0, sizeof(alertWords));
+    double start = nowSeconds();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        kernel(rainfallIn, temperatureIn, level, alertWords, 0, RECORDS);
+    }
+    double elapsed = (nowSeconds() - start) / ROUNDS;
+
+    int identical = memcmp(level, expectedLevel, sizeof(level)) == 0;
+    for (int i = 0; i < RECORDS && identical; i++)
+    {
+        identical = alertBit(alertWords, i) == alertBit(expectedAlerts, i);
+    }
+    printf("%-12s %-14.1f %-10.2f %s\n", name, RECORDS / elapsed / 1e6, baseline / elapsed, identical ? "bit-identical" : "MISMATCH");
+}
+
+int main()
+{
+    unsigned int seed = 12345;
+    for (int i = 0; i < RECORDS; i++)
+    {
+        randomReading(&seed, 50000, 6000, -10.0f, &rainfallIn[i], &temperatureIn[i]);
+    }
+
+    // Per-record path as update_predictions used to do it
+    char status[10];
+    double start = nowSeconds();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        for (int i = 0; i < RECORDS; i++)
+        {
+            expectedLevel[i] = calculate_water_level(rainfallIn[i], temperatureIn[i]);
+            strcpy(status, expectedLevel[i] > THRESHOLD_WATER_LEVEL ? "ON" : "OFF");
+            setAlertBit(expectedAlerts, i, status[1] == 'N');
+        }
+    }
+    double baseline = (nowSeconds() - start) / ROUNDS;
+
+    printf("%-12s %-14s %-10s\n", "Kernel", "Mrecords/s", "Speedup");
+    printf("%-12s %-14.1f %-10.2f\n", "per-record", RECORDS / baseline / 1e6, 1.0);
+    runKernel("scalar", calculate_water_level_batch_scalar, baseline);
+#ifdef HAVE_X86_KERNELS
+    runKernel("sse2", calculate_water_level_batch_sse2, baseline);
+    if (__builtin_cpu_supports("avx2"))
+    {
+        runKernel("avx2", calculate_water_level_batch_avx2, baseline);
+    }
+#endif
+    return 0;
+}